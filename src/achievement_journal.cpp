@@ -0,0 +1,108 @@
+#include "achievement_journal.h"
+
+#include "util.h"
+
+#include <fstream>
+
+std::filesystem::path achievement_journal::get_filepath()
+{
+	const std::filesystem::path user_data_path = get_user_data_path();
+
+	std::filesystem::path filepath = user_data_path / "achievement_journal.txt";
+	filepath.make_preferred();
+	return filepath;
+}
+
+void achievement_journal::load()
+{
+	this->entries.clear();
+
+	const std::filesystem::path filepath = achievement_journal::get_filepath();
+
+	if (!std::filesystem::exists(filepath)) {
+		return;
+	}
+
+	std::ifstream ifstream(filepath);
+
+	if (!ifstream) {
+		throw std::runtime_error("Failed to open the achievement journal for reading.");
+	}
+
+	//each line consists of the operation followed by the achievement key, e.g. "unlock <key>"
+	std::string line;
+	while (std::getline(ifstream, line)) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+
+		const size_t separator_pos = line.find(' ');
+		const std::string_view operation = std::string_view(line).substr(0, separator_pos);
+		const std::string key = separator_pos != std::string::npos ? line.substr(separator_pos + 1) : std::string();
+
+		if (key.empty() || (operation != "unlock" && operation != "clear")) {
+			log_error("Invalid line in the achievement journal: \"" + line + "\".");
+			continue;
+		}
+
+		this->entries[key] = operation == "clear";
+	}
+}
+
+void achievement_journal::save() const
+{
+	const std::filesystem::path filepath = achievement_journal::get_filepath();
+
+	if (this->entries.empty()) {
+		std::filesystem::remove(filepath);
+		return;
+	}
+
+	std::filesystem::path temp_filepath = filepath;
+	temp_filepath += ".tmp";
+
+	{
+		std::ofstream ofstream(temp_filepath, std::ios::trunc);
+
+		if (!ofstream) {
+			throw std::runtime_error("Failed to open the achievement journal for writing.");
+		}
+
+		for (const auto &[key, clear] : this->entries) {
+			ofstream << (clear ? "clear " : "unlock ") << key << '\n';
+		}
+
+		if (!ofstream) {
+			throw std::runtime_error("Failed to write the achievement journal.");
+		}
+	}
+
+	//replace the journal in one step, so that an interrupted write cannot leave it incomplete
+	std::filesystem::rename(temp_filepath, filepath);
+}
+
+bool achievement_journal::add_entry(const std::string_view key, const bool clear)
+{
+	const auto find_iterator = this->entries.find(key);
+
+	if (find_iterator != this->entries.end()) {
+		if (find_iterator->second == clear) {
+			return false;
+		}
+
+		find_iterator->second = clear;
+		return true;
+	}
+
+	this->entries.emplace(key, clear);
+	return true;
+}
+
+void achievement_journal::remove_entry(const std::string_view key)
+{
+	const auto find_iterator = this->entries.find(key);
+
+	if (find_iterator != this->entries.end()) {
+		this->entries.erase(find_iterator);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+
+//on-disk journal of achievement changes which could not be made on Steam yet, e.g. because Steam was unavailable, so that they are made once it is available again, even in a later session
+//each achievement has at most one entry, so that the journal stays bounded however long Steam is unavailable
+class achievement_journal final
+{
+public:
+	static std::filesystem::path get_filepath();
+
+	void load();
+	void save() const;
+
+	bool is_empty() const
+	{
+		return this->entries.empty();
+	}
+
+	size_t get_entry_count() const
+	{
+		return this->entries.size();
+	}
+
+	const std::map<std::string, bool, std::less<>> &get_entries() const
+	{
+		return this->entries;
+	}
+
+	//record that an achievement is to be unlocked or cleared, replacing any previous entry for it; returns true if the journal changed
+	bool add_entry(const std::string_view key, const bool clear);
+
+	void remove_entry(const std::string_view key);
+
+private:
+	std::map<std::string, bool, std::less<>> entries; //whether each achievement is to be cleared instead of unlocked, mapped to the achievement keys
+};
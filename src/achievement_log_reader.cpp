@@ -0,0 +1,83 @@
+#include "achievement_log_reader.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <fstream>
+
+bool achievement_log_reader::read_header(std::istream &istream, const uintmax_t file_size)
+{
+	this->buffer.resize(static_cast<size_t>(std::min<uintmax_t>(file_size, achievement_log_reader::max_header_size)));
+	istream.seekg(0);
+	istream.read(this->buffer.data(), static_cast<std::streamsize>(this->buffer.size()));
+	this->buffer.resize(static_cast<size_t>(istream.gcount()));
+	istream.clear();
+
+	const std::string_view data = this->buffer;
+	const size_t header_end_pos = data.find('\n');
+
+	if (header_end_pos == std::string_view::npos) {
+		if (data.size() == achievement_log_reader::max_header_size) {
+			throw std::runtime_error("The achievement log header is too long.");
+		}
+
+		//the header has not been completely written yet
+		return false;
+	}
+
+	std::string_view header = data.substr(0, header_end_pos);
+
+	if (!header.empty() && header.back() == '\r') {
+		header.remove_suffix(1);
+	}
+
+	if (!header.starts_with(achievement_log_reader::header_prefix)) {
+		throw std::runtime_error("The achievement log has an invalid header.");
+	}
+
+	const std::string_view generation = header.substr(achievement_log_reader::header_prefix.size());
+
+	if (generation != this->generation || this->offset == 0 || this->offset > file_size) {
+		//a new log has been started, so read it from the beginning
+		this->generation = generation;
+		this->offset = header_end_pos + 1;
+	}
+
+	return true;
+}
+
+bool achievement_log_reader::read_new_data(const std::filesystem::path &filepath)
+{
+	this->buffer.clear();
+
+	const uintmax_t file_size = std::filesystem::file_size(filepath);
+	const std::filesystem::file_time_type last_modified = std::filesystem::last_write_time(filepath);
+
+	if (file_size == this->previous_file_size && last_modified == this->previous_last_modified) {
+		//no change
+		return true;
+	}
+
+	std::ifstream ifstream(filepath, std::ios::binary);
+
+	if (!ifstream) {
+		throw std::runtime_error("Failed to open file \"" + to_string(filepath) + "\" for reading.");
+	}
+
+	if (!this->read_header(ifstream, file_size)) {
+		this->buffer.clear();
+		return false;
+	}
+
+	this->buffer.resize(static_cast<size_t>(file_size - this->offset));
+	ifstream.seekg(static_cast<std::streamoff>(this->offset));
+	ifstream.read(this->buffer.data(), static_cast<std::streamsize>(this->buffer.size()));
+
+	//if the file was truncated since its size was queried, only keep the part which was actually read
+	this->buffer.resize(static_cast<size_t>(ifstream.gcount()));
+
+	this->previous_file_size = file_size;
+	this->previous_last_modified = last_modified;
+
+	return true;
+}
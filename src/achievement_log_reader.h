@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+//reader for the append-only achievement log, which consists of a generation header line followed by one achievement key per line
+//the reader remembers how far it has read, so that each read only processes the keys appended since the previous one
+class achievement_log_reader final
+{
+public:
+	static constexpr std::string_view header_prefix = "wyrmsun-achievements ";
+	static constexpr size_t max_header_size = 64;
+
+	//call the function for each complete key appended since the previous read; the string views passed to it are only valid during the call
+	//returns false if a partially-written header or line was found, in which case the rest of it is read on a subsequent call
+	template <typename function_type>
+	bool read_new_keys(const std::filesystem::path &filepath, const function_type &function)
+	{
+		if (!this->read_new_data(filepath)) {
+			this->previous_file_size = 0;
+			return false;
+		}
+
+		const std::string_view data = this->buffer;
+		size_t start_pos = 0;
+		size_t end_pos = 0;
+
+		while ((end_pos = data.find('\n', start_pos)) != std::string_view::npos) {
+			std::string_view key = data.substr(start_pos, end_pos - start_pos);
+
+			if (key.find('\0') != std::string_view::npos) {
+				//zero bytes indicate that the space for the line has been allocated, but the line has not been written yet
+				break;
+			}
+
+			start_pos = end_pos + 1;
+
+			if (!key.empty() && key.back() == '\r') {
+				key.remove_suffix(1);
+			}
+
+			if (!key.empty()) {
+				function(key);
+			}
+		}
+
+		this->offset += start_pos;
+
+		if (start_pos != data.size()) {
+			//the data after the last complete line is from a write which is still in progress, so make the next read retry it even if the file appears unchanged
+			this->previous_file_size = 0;
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	bool read_header(std::istream &istream, const uintmax_t file_size);
+	bool read_new_data(const std::filesystem::path &filepath);
+
+private:
+	std::string generation; //the generation of the log, which changes when the game starts a new log instead of appending to the existing one
+	uintmax_t offset = 0; //the byte offset up to which the log has been consumed
+	uintmax_t previous_file_size = 0;
+	std::filesystem::file_time_type previous_last_modified;
+	std::string buffer;
+};
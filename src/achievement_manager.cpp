@@ -1,10 +1,85 @@
 #include "achievement_manager.h"
 
+#include "steam_backend.h"
+#include "trace.h"
 #include "util.h"
 
-#include "steam/isteamuserstats.h"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iterator>
 
-#include <QSettings>
+static std::string read_file(const std::filesystem::path &filepath)
+{
+	std::ifstream ifstream(filepath, std::ios::binary);
+
+	if (!ifstream) {
+		throw std::runtime_error("Failed to open file \"" + to_string(filepath) + "\" for reading.");
+	}
+
+	return std::string(std::istreambuf_iterator<char>(ifstream), std::istreambuf_iterator<char>());
+}
+
+static std::string_view trim(std::string_view str)
+{
+	static constexpr std::string_view whitespace = " \t\r";
+
+	const size_t start_pos = str.find_first_not_of(whitespace);
+	if (start_pos == std::string_view::npos) {
+		return std::string_view();
+	}
+
+	const size_t end_pos = str.find_last_not_of(whitespace);
+	return str.substr(start_pos, end_pos - start_pos + 1);
+}
+
+//call the function for each key of INI data with its section and value; keys outside of any section are in the "General" section, as with QSettings
+template <typename function_type>
+static void parse_ini(const std::string_view data, const function_type &function)
+{
+	std::string_view section = "General";
+
+	size_t start_pos = 0;
+	while (start_pos < data.size()) {
+		size_t end_pos = data.find('\n', start_pos);
+		if (end_pos == std::string_view::npos) {
+			end_pos = data.size();
+		}
+
+		const std::string_view line = trim(data.substr(start_pos, end_pos - start_pos));
+		start_pos = end_pos + 1;
+
+		if (line.empty() || line.front() == ';' || line.front() == '#') {
+			continue;
+		}
+
+		if (line.front() == '[') {
+			section = trim(line.substr(1, line.find(']') - 1));
+			continue;
+		}
+
+		const size_t separator_pos = line.find('=');
+		const std::string_view key = trim(line.substr(0, separator_pos));
+		const std::string_view value = separator_pos != std::string_view::npos ? trim(line.substr(separator_pos + 1)) : std::string_view();
+
+		if (!key.empty()) {
+			function(section, key, value);
+		}
+	}
+}
+
+template <typename number_type>
+static bool parse_number(const std::string_view str, number_type &number)
+{
+	const char *end_ptr = str.data() + str.size();
+	const std::from_chars_result result = std::from_chars(str.data(), end_ptr, number);
+	return result.ec == std::errc() && result.ptr == end_ptr;
+}
+
+static bool is_steam_available(const steam_backend *steam)
+{
+	return steam->is_user_stats_available() && steam->is_user_stats_received();
+}
 
 std::filesystem::path achievement_manager::get_achievements_filepath()
 {
@@ -15,73 +90,686 @@ std::filesystem::path achievement_manager::get_achievements_filepath()
 	return filepath;
 }
 
+std::filesystem::path achievement_manager::get_achievement_log_filepath()
+{
+	const std::filesystem::path user_data_path = get_user_data_path();
+
+	std::filesystem::path filepath = user_data_path / "achievements.log";
+	filepath.make_preferred();
+	return filepath;
+}
+
+achievement_manager::achievement_manager(const bool clear) : clear(clear)
+{
+	try {
+		this->journal.load();
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+	}
+
+	steam_backend::get()->set_user_stats_received_function([this]() {
+		//Steam has become available, so make the changes which had to wait for it
+		this->flush_journal();
+		this->flush_stats();
+	});
+
+	steam_backend::get()->set_user_stats_stored_function([this](const EResult result) {
+		this->on_stats_stored(result == k_EResultOK, result == k_EResultInvalidParam);
+	});
+}
+
+achievement_manager::~achievement_manager()
+{
+	this->stop_continuous_checking();
+
+	if (steam_backend::get() != nullptr) {
+		steam_backend::get()->set_user_stats_received_function(nullptr);
+		steam_backend::get()->set_user_stats_stored_function(nullptr);
+	}
+
+	//pending stat changes are not stored here, since Steam may have been shut down already; flush_stats() needs to be called beforehand
+	delete this->store_timer;
+	delete this->retry_timer;
+}
+
+void achievement_manager::start_continuous_checking()
+{
+	if (this->debounce_timer != nullptr) {
+		return;
+	}
+
+	this->debounce_timer = new QTimer(QApplication::instance());
+	this->debounce_timer->setSingleShot(true);
+	QObject::connect(this->debounce_timer, &QTimer::timeout, [this]() {
+		this->check_achievements();
+	});
+
+	try {
+		const std::filesystem::path achievements_dir_path = achievement_manager::get_achievements_filepath().parent_path();
+
+		this->watcher = new QFileSystemWatcher(QApplication::instance());
+
+		//watch the directory as well as the file, since the file may not exist yet, and the game may replace it instead of writing to it in place
+		QObject::connect(this->watcher, &QFileSystemWatcher::directoryChanged, [this]() {
+			this->watch_achievements_file();
+			this->schedule_check();
+		});
+
+		QObject::connect(this->watcher, &QFileSystemWatcher::fileChanged, [this]() {
+			this->watch_achievements_file();
+			this->schedule_check();
+		});
+
+		if (!this->watcher->addPath(to_qstring(achievements_dir_path))) {
+			throw std::runtime_error("Failed to watch the achievements directory: \"" + to_string(achievements_dir_path) + "\".");
+		}
+
+		this->watch_achievements_file();
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+		log_error("Falling back to periodic achievement checking.");
+
+		this->start_fallback_checking();
+	}
+}
+
+void achievement_manager::stop_continuous_checking()
+{
+	//delete the objects directly instead of via deleteLater(), so that no pending signal can reach a destroyed achievement manager
+	delete this->watcher;
+	this->watcher = nullptr;
+
+	delete this->debounce_timer;
+	this->debounce_timer = nullptr;
+
+	delete this->fallback_timer;
+	this->fallback_timer = nullptr;
+}
+
+void achievement_manager::watch_achievements_file()
+{
+	for (const std::filesystem::path &filepath : { achievement_manager::get_achievements_filepath(), achievement_manager::get_achievement_log_filepath() }) {
+		const QString filepath_qstr = to_qstring(filepath);
+
+		//the file is dropped from the watch list when it is removed or replaced, so it needs to be added again once it exists
+		if (!this->watcher->files().contains(filepath_qstr) && std::filesystem::exists(filepath)) {
+			this->watcher->addPath(filepath_qstr);
+		}
+	}
+}
+
+void achievement_manager::start_fallback_checking()
+{
+	delete this->watcher;
+	this->watcher = nullptr;
+
+	this->fallback_timer = new QTimer(QApplication::instance());
+	QObject::connect(this->fallback_timer, &QTimer::timeout, [this]() {
+		this->check_achievements();
+	});
+	this->fallback_timer->start(achievement_manager::fallback_check_interval_ms);
+}
+
 void achievement_manager::check_achievements()
 {
+	trace_span span("check_achievements", "achievements");
+	this->processed_key_count = 0;
+	this->steam_call_count = 0;
+
 	try {
-		const std::filesystem::path achievements_filepath = achievement_manager::get_achievements_filepath();
+		//changes recorded while Steam was unavailable are made first, so that they are not overridden by the ones from this check
+		if (!this->journal.is_empty() && (this->retry_timer == nullptr || !this->retry_timer->isActive())) {
+			this->flush_journal();
+		}
 
-		if (!std::filesystem::exists(achievements_filepath)) {
-			return;
+		//the append-only log is used instead of the INI file if the game writes it
+		const std::filesystem::path achievement_log_filepath = achievement_manager::get_achievement_log_filepath();
+
+		if (std::filesystem::exists(achievement_log_filepath)) {
+			this->check_achievement_log(achievement_log_filepath);
+		} else {
+			this->check_achievement_ini(achievement_manager::get_achievements_filepath());
 		}
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+	}
 
-		const std::filesystem::file_time_type last_modified = std::filesystem::last_write_time(achievements_filepath);
+	span.add_arg("key_count", this->processed_key_count);
+	span.add_arg("steam_calls", this->steam_call_count);
+}
 
-		if (last_modified <= this->previous_last_modified) {
-			//no change, nothing to check
-			return;
+void achievement_manager::sync_achievements(const std::vector<std::string> &keys)
+{
+	trace_span span("sync_achievements", "achievements");
+	this->processed_key_count = 0;
+	this->steam_call_count = 0;
+
+	try {
+		steam_backend *steam = steam_backend::get();
+		bool changed = false;
+
+		for (const std::string &key : keys) {
+			if (this->sync_achievement(steam, key, this->clear)) {
+				changed = true;
+			}
 		}
 
-		const QString achievements_filepath_qstr = to_qstring(achievements_filepath);
-		const QSettings data(achievements_filepath_qstr, QSettings::IniFormat);
+		this->finish_sync(changed);
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+	}
+
+	span.add_arg("key_count", this->processed_key_count);
+	span.add_arg("steam_calls", this->steam_call_count);
+}
+
+void achievement_manager::check_achievement_ini(const std::filesystem::path &filepath)
+{
+	if (!std::filesystem::exists(filepath)) {
+		return;
+	}
 
-		ISteamUserStats *user_stats = SteamUserStats();
+	const std::filesystem::file_time_type last_modified = std::filesystem::last_write_time(filepath);
+
+	if (last_modified <= this->previous_last_modified) {
+		//no change, nothing to check
+		return;
+	}
+
+	trace_span parse_span("parse_achievements", "achievements");
+	const std::string data = read_file(filepath);
+	const size_t content_hash = std::hash<std::string_view>()(data);
+
+	if (content_hash == this->previous_content_hash) {
+		//the file was rewritten without its contents changing
+		this->previous_last_modified = last_modified;
+		return;
+	}
 
-		if (user_stats == nullptr) {
-			throw std::runtime_error("No Steam user information provided.");
+	steam_backend *steam = steam_backend::get();
+
+	//the game writes its unlocked achievements as top-level keys, numeric stats in a "stats" section, e.g. "units_killed=42", and achievement progress in a "progress" section, e.g. "kill_100_units=42/100"
+	std::vector<std::string_view> keys;
+	std::vector<std::pair<std::string_view, std::string_view>> stat_entries;
+	std::vector<std::pair<std::string_view, std::string_view>> progress_entries;
+
+	parse_ini(data, [&keys, &stat_entries, &progress_entries](const std::string_view section, const std::string_view key, const std::string_view value) {
+		if (section == "General") {
+			keys.push_back(key);
+		} else if (section == "stats") {
+			stat_entries.emplace_back(key, value);
+		} else if (section == "progress") {
+			progress_entries.emplace_back(key, value);
+		}
+	});
+
+	parse_span.add_arg("key_count", keys.size());
+	parse_span.end();
+
+	bool changed = false;
+
+	for (const std::string_view &key : keys) {
+		if (this->sync_achievement(steam, key, this->clear)) {
+			changed = true;
+		}
+	}
+
+	this->finish_sync(changed);
+
+	for (const auto &[name, value_str] : stat_entries) {
+		int32_t value = 0;
+
+		if (!parse_number(value_str, value)) {
+			log_error("Invalid value for stat \"" + std::string(name) + "\": \"" + std::string(value_str) + "\".");
+			continue;
+		}
+
+		this->update_stat(name, value);
+	}
+
+	for (const auto &[key, progress_str] : progress_entries) {
+		const size_t separator_pos = progress_str.find('/');
+		uint32_t current_progress = 0;
+		uint32_t max_progress = 0;
+
+		if (separator_pos == std::string_view::npos || !parse_number(trim(progress_str.substr(0, separator_pos)), current_progress) || !parse_number(trim(progress_str.substr(separator_pos + 1)), max_progress)) {
+			log_error("Invalid progress for achievement \"" + std::string(key) + "\": \"" + std::string(progress_str) + "\".");
+			continue;
+		}
+
+		this->update_achievement_progress(key, current_progress, max_progress);
+	}
+
+	this->previous_last_modified = last_modified;
+	this->previous_content_hash = content_hash;
+}
+
+void achievement_manager::check_achievement_log(const std::filesystem::path &filepath)
+{
+	steam_backend *steam = steam_backend::get();
+	bool changed = false;
+
+	const bool complete = this->log_reader.read_new_keys(filepath, [this, steam, &changed](const std::string_view key) {
+		if (this->sync_achievement(steam, key, this->clear)) {
+			changed = true;
 		}
+	});
+
+	this->finish_sync(changed);
+
+	if (complete) {
+		this->incomplete_log_check_count = 0;
+		return;
+	}
 
-		for (QString key : data.childKeys()) {
-			key.replace("_", "-");
+	//a write was in progress, check again once it has finished; if the log stays incomplete, e.g. because the game exited during the write, the next write to it triggers a check anyway
+	if (this->debounce_timer != nullptr && this->incomplete_log_check_count < achievement_manager::max_incomplete_log_checks) {
+		++this->incomplete_log_check_count;
+		this->schedule_check();
+	}
+}
 
-			const std::string key_str = key.toStdString();
+bool achievement_manager::sync_achievement(steam_backend *steam, const std::string_view key, const bool clear_achievement)
+{
+	++this->processed_key_count;
+
+	if (this->synced_achievements.contains(key)) {
+		return false;
+	}
+
+	if (!is_steam_available(steam)) {
+		if (this->journal.add_entry(key, clear_achievement)) {
+			this->journal_changed = true;
+		}
+
+		return false;
+	}
 
-			bool unlocked = false;
-			bool result = user_stats->GetAchievement(key_str.c_str(), &unlocked);
+	//achievement identifiers use hyphens on Steam, but the game writes them with underscores
+	std::string key_str(key);
+	std::replace(key_str.begin(), key_str.end(), '_', '-');
+
+	bool unlocked = false;
+	bool result = steam->get_achievement(key_str.c_str(), &unlocked);
+	++this->steam_call_count;
+
+	if (!result) {
+		const bool registered = steam->is_achievement_registered(key_str.c_str());
+		++this->steam_call_count;
+
+		if (registered) {
+			//a transient failure, so keep the achievement in the journal to be retried
+			log_error("Failed to get achievement \"" + key_str + "\" from Steam.");
+			this->journal_changed |= this->journal.add_entry(key, clear_achievement);
+			return false;
+		}
+
+		log_error("Achievement \"" + key_str + "\" is not registered on Steam.");
+		this->synced_achievements.emplace(key);
+		return false;
+	}
+
+	bool changed = false;
+
+	if (clear_achievement) {
+		if (unlocked) {
+			result = steam->clear_achievement(key_str.c_str());
+			++this->steam_call_count;
 
 			if (!result) {
-				log_error("Achievement \"" + key_str + "\" is not registered on Steam.");
+				log_error("Failed to clear achievement \"" + key_str + "\" on Steam.");
+				this->journal_changed |= this->journal.add_entry(key, clear_achievement);
+				return false;
+			}
+
+			changed = true;
+		}
+	} else {
+		if (!unlocked) {
+			result = steam->set_achievement(key_str.c_str());
+			++this->steam_call_count;
+
+			if (!result) {
+				log_error("Failed to unlock achievement \"" + key_str + "\" on Steam.");
+				this->journal_changed |= this->journal.add_entry(key, clear_achievement);
+				return false;
+			}
+
+			changed = true;
+		}
+	}
+
+	this->synced_achievements.emplace(key);
+
+	return changed;
+}
+
+void achievement_manager::update_stat(const std::string_view name, const int32_t value)
+{
+	++this->received_stat_update_count;
+
+	//compare with the value being stored if there is one, since it will replace the value stored before
+	const auto sent_iterator = this->sent_stats.find(name);
+	const auto flushed_iterator = this->flushed_stats.find(name);
+	const bool unchanged = sent_iterator != this->sent_stats.end() ? sent_iterator->second.value == value : flushed_iterator != this->flushed_stats.end() && flushed_iterator->second == value;
+
+	if (unchanged) {
+		//the stat may have been changed and changed back within the coalescing interval
+		const auto pending_iterator = this->pending_stats.find(name);
+		if (pending_iterator != this->pending_stats.end()) {
+			this->pending_stats.erase(pending_iterator);
+		}
+
+		return;
+	}
+
+	const auto pending_iterator = this->pending_stats.find(name);
+	if (pending_iterator != this->pending_stats.end()) {
+		pending_iterator->second = value;
+	} else {
+		this->pending_stats.emplace(name, value);
+	}
+
+	this->schedule_flush();
+}
+
+void achievement_manager::update_achievement_progress(const std::string_view key, const uint32_t current_progress, const uint32_t max_progress)
+{
+	++this->received_stat_update_count;
+
+	//Steam only shows progress towards achievements which have not been reached yet; reaching them is handled by unlocking the achievement
+	if (current_progress >= max_progress) {
+		return;
+	}
+
+	//achievement identifiers use hyphens on Steam, but the game writes them with underscores
+	std::string key_str(key);
+	std::replace(key_str.begin(), key_str.end(), '_', '-');
+
+	achievement_progress progress;
+	progress.current_progress = current_progress;
+	progress.max_progress = max_progress;
+
+	const auto flushed_iterator = this->flushed_progress.find(key_str);
+	if (flushed_iterator != this->flushed_progress.end() && flushed_iterator->second == progress) {
+		return;
+	}
+
+	this->pending_progress[key_str] = progress;
+	this->schedule_flush();
+}
+
+void achievement_manager::flush_stats()
+{
+	if (this->store_timer != nullptr) {
+		this->store_timer->stop();
+	}
+
+	if (!this->achievements_changed && this->pending_stats.empty() && this->pending_progress.empty()) {
+		return;
+	}
+
+	steam_backend *steam = steam_backend::get();
+
+	if (!is_steam_available(steam)) {
+		//the changes are kept until Steam is available, which calls this function again
+		return;
+	}
+
+	trace_span span("flush_stats", "achievements");
+	span.add_arg("stat_count", this->pending_stats.size());
+	span.add_arg("progress_count", this->pending_progress.size());
+
+	try {
+		bool changed = this->achievements_changed;
+
+		//the values are only considered stored once Steam confirms it, and values which could not be set are kept pending, to be retried with the next flush
+		for (auto iterator = this->pending_stats.begin(); iterator != this->pending_stats.end();) {
+			const auto &[name, value] = *iterator;
+
+			if (!steam->set_stat(name.c_str(), value)) {
+				log_error("Failed to set stat \"" + name + "\" on Steam.");
+				++iterator;
 				continue;
 			}
 
-			if (this->clear) {
-				if (unlocked) {
-					result = user_stats->ClearAchievement(key_str.c_str());
+			this->sent_stats[name] = sent_stat{ value, this->issued_store_count + 1 };
+			++this->flushed_stat_update_count;
+			changed = true;
+			iterator = this->pending_stats.erase(iterator);
+		}
+
+		for (auto iterator = this->pending_progress.begin(); iterator != this->pending_progress.end();) {
+			const auto &[key, progress] = *iterator;
 
-					if (!result) {
-						log_error("Failed to clear achievement \"" + key_str + "\" on Steam.");
-					}
+			//showing the progress does not change any stats, so it does not need to be stored
+			if (!steam->indicate_achievement_progress(key.c_str(), progress.current_progress, progress.max_progress)) {
+				//Steam refuses to show the progress of achievements which are already unlocked, so retrying it would fail again
+				bool achieved = false;
+				if (steam->get_achievement(key.c_str(), &achieved) && achieved) {
+					iterator = this->pending_progress.erase(iterator);
+					continue;
 				}
+
+				log_error("Failed to indicate the progress of achievement \"" + key + "\" on Steam.");
+				++iterator;
+				continue;
+			}
+
+			this->flushed_progress[key] = progress;
+			++this->flushed_stat_update_count;
+			iterator = this->pending_progress.erase(iterator);
+		}
+
+		if (changed) {
+			++this->store_count;
+			this->last_store_time = std::chrono::steady_clock::now();
+
+			if (steam->store_stats()) {
+				++this->issued_store_count;
+				this->achievements_changed = false;
 			} else {
-				if (!unlocked) {
-					result = user_stats->SetAchievement(key_str.c_str());
+				log_error("Failed to store stats on Steam.");
+				++this->failed_store_count;
 
-					if (!result) {
-						log_error("Failed to unlock achievement \"" + key_str + "\" on Steam.");
-					}
-				}
+				//the values sent in this flush are not part of any store, so they are sent again with the next one
+				this->requeue_sent_stats(this->issued_store_count + 1, this->issued_store_count + 1);
+				this->achievements_changed = true;
+				this->schedule_flush();
 			}
 		}
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+	}
+}
 
-		user_stats->StoreStats();
+void achievement_manager::on_stats_stored(const bool success, const bool rejected)
+{
+	//the results arrive in the order in which the stores were made; a result without an accepted store is not for a store made by the launcher
+	if (this->completed_store_count == this->issued_store_count) {
+		return;
+	}
 
-		this->previous_last_modified = last_modified;
+	++this->completed_store_count;
+	const uint64_t store_index = this->completed_store_count;
+
+	if (success) {
+		for (auto iterator = this->sent_stats.begin(); iterator != this->sent_stats.end();) {
+			if (iterator->second.store_index > store_index) {
+				++iterator;
+				continue;
+			}
+
+			this->flushed_stats[iterator->first] = iterator->second.value;
+			iterator = this->sent_stats.erase(iterator);
+		}
+
+		return;
+	}
+
+	++this->failed_store_count;
+
+	if (rejected) {
+		//Steam has reverted the stats and reloads them, so the stored values are no longer known; the rejected values are not sent again, as they would fail validation again
+		log_error("Steam rejected the stored stats, and reverted them.");
+
+		this->flushed_stats.clear();
+
+		for (auto iterator = this->sent_stats.begin(); iterator != this->sent_stats.end();) {
+			if (iterator->second.store_index <= store_index) {
+				iterator = this->sent_stats.erase(iterator);
+			} else {
+				++iterator;
+			}
+		}
+
+		return;
+	}
+
+	log_error("Failed to store stats on Steam.");
+
+	this->requeue_sent_stats(store_index, store_index);
+	this->achievements_changed = true;
+	this->schedule_flush();
+}
+
+void achievement_manager::requeue_sent_stats(const uint64_t first_store_index, const uint64_t last_store_index)
+{
+	for (auto iterator = this->sent_stats.begin(); iterator != this->sent_stats.end();) {
+		const auto &[name, stat] = *iterator;
 
-		if (this->timer != nullptr && this->timer->isSingleShot()) {
-			//the initial check interval has gone by, now set the timer to recurrently check, with a smaller interval
-			this->timer->setSingleShot(false);
-			this->timer->start(achievement_manager::check_interval_ms);
+		if (stat.store_index < first_store_index || stat.store_index > last_store_index) {
+			++iterator;
+			continue;
 		}
+
+		//a value received from the game since it was sent replaces it
+		this->pending_stats.try_emplace(name, stat.value);
+		iterator = this->sent_stats.erase(iterator);
+	}
+}
+
+void achievement_manager::schedule_flush()
+{
+	if (this->store_timer == nullptr) {
+		this->store_timer = new QTimer(QApplication::instance());
+		this->store_timer->setSingleShot(true);
+		QObject::connect(this->store_timer, &QTimer::timeout, [this]() {
+			this->flush_stats();
+		});
+	}
+
+	if (this->store_timer->isActive()) {
+		//the change will be flushed together with the ones already pending
+		return;
+	}
+
+	const std::chrono::steady_clock::duration time_since_store = std::chrono::steady_clock::now() - this->last_store_time;
+	const int time_since_store_ms = static_cast<int>(std::min<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(time_since_store).count(), achievement_manager::min_store_interval_ms));
+
+	this->store_timer->start(std::max(achievement_manager::store_coalesce_interval_ms, achievement_manager::min_store_interval_ms - time_since_store_ms));
+}
+
+void achievement_manager::flush_journal()
+{
+	if (this->retry_timer != nullptr) {
+		this->retry_timer->stop();
+	}
+
+	if (this->journal.is_empty()) {
+		return;
+	}
+
+	steam_backend *steam = steam_backend::get();
+
+	if (!is_steam_available(steam)) {
+		this->schedule_retry();
+		return;
+	}
+
+	trace_span span("flush_journal", "achievements");
+	const size_t entry_count = this->journal.get_entry_count();
+	span.add_arg("entry_count", entry_count);
+
+	//copy the entries, since failed changes are recorded in the journal again
+	const std::map<std::string, bool, std::less<>> entries = this->journal.get_entries();
+	bool changed = false;
+
+	for (const auto &[key, clear_achievement] : entries) {
+		if (this->sync_achievement(steam, key, clear_achievement)) {
+			changed = true;
+		}
+
+		//the achievement is in the synchronized set if it was changed, or if it did not need to be
+		if (this->synced_achievements.contains(key)) {
+			this->journal.remove_entry(key);
+			this->journal_changed = true;
+		}
+	}
+
+	this->finish_sync(changed);
+
+	if (this->journal.is_empty()) {
+		this->retry_interval_ms = achievement_manager::min_retry_interval_ms;
+		log("Synchronized " + std::to_string(entry_count) + " journaled achievement changes with Steam.");
+	}
+}
+
+void achievement_manager::finish_sync(const bool changed)
+{
+	if (changed) {
+		this->achievements_changed = true;
+		this->schedule_flush();
+	}
+
+	if (!this->journal_changed) {
+		return;
+	}
+
+	this->journal_changed = false;
+
+	try {
+		this->journal.save();
 	} catch (const std::exception &exception) {
 		report_exception(exception);
 	}
+
+	if (!this->journal.is_empty() && (this->retry_timer == nullptr || !this->retry_timer->isActive())) {
+		log("Recorded " + std::to_string(this->journal.get_entry_count()) + " achievement changes in the journal, to be made once Steam is available.");
+		this->schedule_retry();
+	}
+}
+
+void achievement_manager::schedule_retry()
+{
+	if (this->journal.is_empty()) {
+		return;
+	}
+
+	if (this->retry_timer == nullptr) {
+		this->retry_timer = new QTimer(QApplication::instance());
+		this->retry_timer->setSingleShot(true);
+		QObject::connect(this->retry_timer, &QTimer::timeout, [this]() {
+			steam_backend *steam = steam_backend::get();
+
+			if (is_steam_available(steam)) {
+				this->flush_journal();
+				return;
+			}
+
+			//ask for the stats again, as the previous request may have failed; the journal is flushed when they are received
+			if (steam->is_user_stats_available()) {
+				steam->request_current_stats();
+			}
+
+			this->retry_interval_ms = std::min(this->retry_interval_ms * 2, achievement_manager::max_retry_interval_ms);
+			this->schedule_retry();
+		});
+	}
+
+	if (this->retry_timer->isActive()) {
+		return;
+	}
+
+	this->retry_timer->start(this->retry_interval_ms);
 }
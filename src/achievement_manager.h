@@ -1,43 +1,160 @@
 #pragma once
 
+#include "achievement_journal.h"
+#include "achievement_log_reader.h"
+
 #include <QApplication>
+#include <QFileSystemWatcher>
 #include <QTimer>
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class steam_backend;
 
 class achievement_manager final
 {
 public:
-	static constexpr int initial_check_interval_ms = 10000;
-	static constexpr int check_interval_ms = 1000;
+	static constexpr int debounce_interval_ms = 100; //the time to wait after a change notification before checking, so that a burst of writes results in a single check
+	static constexpr int fallback_check_interval_ms = 1000; //used only if the achievements file cannot be watched for changes
+	static constexpr int max_incomplete_log_checks = 20; //the number of times the achievement log is checked again while a write to it appears to be in progress, before waiting for the next change notification instead
+	static constexpr int store_coalesce_interval_ms = 500; //the time during which changes are gathered before being stored on Steam together, so that a burst of updates results in a single store
+	static constexpr int min_store_interval_ms = 5000; //the minimum time between stores, so that a game which updates its stats continuously stays under Steam's rate limits
+	static constexpr int min_retry_interval_ms = 1000; //the initial time to wait before retrying to synchronize the journaled changes, which is doubled after each failed retry
+	static constexpr int max_retry_interval_ms = 5 * 60 * 1000;
 
 	static std::filesystem::path get_achievements_filepath();
+	static std::filesystem::path get_achievement_log_filepath();
+
+	explicit achievement_manager(const bool clear);
+	~achievement_manager();
+
+	void start_continuous_checking();
+	void stop_continuous_checking();
+
+	void check_achievements();
+	void sync_achievements(const std::vector<std::string> &keys);
+
+	//update the value of a numeric stat; the change is sent to Steam when the pending changes are flushed
+	void update_stat(const std::string_view name, const int32_t value);
+
+	//update the progress towards an achievement, so that Steam can notify the player of it
+	void update_achievement_progress(const std::string_view key, const uint32_t current_progress, const uint32_t max_progress);
+
+	//send the pending stat and progress updates to Steam and store the changes right away, instead of waiting for the coalescing interval to pass
+	void flush_stats();
 
-	explicit achievement_manager(const bool clear) : clear(clear)
+	//make the achievement changes recorded in the journal on Steam, if it is available
+	void flush_journal();
+
+	uint64_t get_received_stat_update_count() const
 	{
+		return this->received_stat_update_count;
 	}
 
-	~achievement_manager()
+	uint64_t get_flushed_stat_update_count() const
 	{
-		if (this->timer != nullptr) {
-			this->timer->deleteLater();
-		}
+		return this->flushed_stat_update_count;
 	}
 
-	void start_continuous_checking()
+	uint64_t get_store_count() const
 	{
-		this->timer = new QTimer(QApplication::instance());
-		QObject::connect(this->timer, &QTimer::timeout, [this]() {
-			this->check_achievements();
-		});
-		this->timer->setSingleShot(true);
-		this->timer->start(achievement_manager::initial_check_interval_ms);
+		return this->store_count;
 	}
 
-	void check_achievements();
+	uint64_t get_failed_store_count() const
+	{
+		return this->failed_store_count;
+	}
+
+	//get the number of stat values which Steam has not confirmed to have stored, including those waiting to be sent again after a failed store
+	size_t get_unstored_stat_count() const
+	{
+		return this->pending_stats.size() + this->sent_stats.size();
+	}
+
+	//get the number of achievement changes in the journal, waiting to be made on Steam
+	size_t get_journaled_change_count() const
+	{
+		return this->journal.get_entry_count();
+	}
+
+private:
+	struct achievement_progress final
+	{
+		bool operator==(const achievement_progress &other) const = default;
+
+		uint32_t current_progress = 0;
+		uint32_t max_progress = 0;
+	};
+
+	struct sent_stat final
+	{
+		int32_t value = 0;
+		uint64_t store_index = 0; //the number of the store which includes the value
+	};
+
+	void watch_achievements_file();
+	void start_fallback_checking();
+
+	void check_achievement_ini(const std::filesystem::path &filepath);
+	void check_achievement_log(const std::filesystem::path &filepath);
+
+	//returns true if the achievement was changed on Steam; if Steam is unavailable or the change fails, it is recorded in the journal instead
+	bool sync_achievement(steam_backend *steam, const std::string_view key, const bool clear_achievement);
+
+	//schedule storing the achievement changes, and save the journal if changes were recorded in it
+	void finish_sync(const bool changed);
+
+	void schedule_check()
+	{
+		//restart the debounce timer, so that the check only occurs once the writes have settled
+		this->debounce_timer->start(achievement_manager::debounce_interval_ms);
+	}
+
+	void schedule_flush();
+	void schedule_retry();
+
+	//handle the result of a store; rejected means that Steam reverted the stats because some of them failed validation
+	void on_stats_stored(const bool success, const bool rejected);
+
+	//make the sent stat values included in the given stores pending again, unless they have been changed since
+	void requeue_sent_stats(const uint64_t first_store_index, const uint64_t last_store_index);
 
 private:
-	QTimer *timer = nullptr;
+	QFileSystemWatcher *watcher = nullptr;
+	QTimer *debounce_timer = nullptr;
+	QTimer *fallback_timer = nullptr;
+	QTimer *store_timer = nullptr;
+	QTimer *retry_timer = nullptr;
+	int retry_interval_ms = achievement_manager::min_retry_interval_ms;
+	achievement_journal journal;
+	bool journal_changed = false; //whether the journal has been changed since it was last saved
 	std::filesystem::file_time_type previous_last_modified; //the last modified time for the previous achievements check
+	size_t previous_content_hash = 0; //the hash of the file contents for the previous achievements check
+	int incomplete_log_check_count = 0; //the number of consecutive checks which found a write to the achievement log in progress
+	std::set<std::string, std::less<>> synced_achievements; //achievements which have already been processed in this session, and so need not be sent to Steam again
+	achievement_log_reader log_reader;
 	bool clear = false;
+	bool achievements_changed = false; //whether achievements have been changed on Steam since the last store
+	std::map<std::string, int32_t, std::less<>> pending_stats; //stat values waiting to be sent to Steam, mapped to the stat names
+	std::map<std::string, sent_stat, std::less<>> sent_stats; //stat values sent to Steam, which it has not confirmed to have stored yet
+	std::map<std::string, int32_t, std::less<>> flushed_stats; //the stat values last stored on Steam
+	std::map<std::string, achievement_progress, std::less<>> pending_progress; //achievement progress waiting to be sent to Steam, mapped to the achievement keys
+	std::map<std::string, achievement_progress, std::less<>> flushed_progress;
+	std::chrono::steady_clock::time_point last_store_time;
+	uint64_t received_stat_update_count = 0; //the number of stat and progress updates received from the game
+	uint64_t flushed_stat_update_count = 0; //the number of stat and progress updates sent to Steam
+	uint64_t store_count = 0;
+	uint64_t failed_store_count = 0; //the number of stores which could not be made, or whose result was a failure
+	uint64_t issued_store_count = 0; //the number of stores which Steam accepted
+	uint64_t completed_store_count = 0; //the number of accepted stores whose result has been received
+	size_t processed_key_count = 0; //the number of keys processed in the current check, for tracing
+	size_t steam_call_count = 0; //the number of Steam calls made in the current check, for tracing
 };
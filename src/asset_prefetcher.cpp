@@ -0,0 +1,379 @@
+#include "asset_prefetcher.h"
+
+#include "trace.h"
+#include "util.h"
+
+#include <QSocketNotifier>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <chrono>
+#include <fstream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+//the ioprio constants are not provided by glibc
+static constexpr int ioprio_who_process = 1;
+static constexpr int ioprio_class_idle = 3;
+static constexpr int ioprio_class_shift = 13;
+
+static void set_idle_io_priority()
+{
+	//with a "who" of 0, the priority is set for the calling thread only
+	syscall(SYS_ioprio_set, ioprio_who_process, 0, ioprio_class_idle << ioprio_class_shift);
+}
+
+static uint64_t prefetch_file(const std::filesystem::path &filepath)
+{
+	const int fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		return 0;
+	}
+
+	//have the kernel read the whole file into the page cache; the reads are queued with the calling thread's I/O priority
+	posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+
+	const off_t size = lseek(fd, 0, SEEK_END);
+	::close(fd);
+
+	return size > 0 ? static_cast<uint64_t>(size) : 0;
+}
+#endif
+
+prefetch_mode string_to_prefetch_mode(const std::string &str)
+{
+	if (str == "off") {
+		return prefetch_mode::off;
+	} else if (str == "directories") {
+		return prefetch_mode::directories;
+	} else if (str == "recorded") {
+		return prefetch_mode::recorded;
+	}
+
+	throw std::runtime_error("Invalid prefetch mode: \"" + str + "\".");
+}
+
+bool asset_prefetcher::is_supported()
+{
+#ifdef __linux__
+	return true;
+#else
+	return false;
+#endif
+}
+
+std::filesystem::path asset_prefetcher::get_recorded_files_filepath()
+{
+	std::filesystem::path filepath = get_user_data_path() / "prefetch_files.txt";
+	filepath.make_preferred();
+	return filepath;
+}
+
+asset_prefetcher::asset_prefetcher(const std::filesystem::path &game_path, const prefetch_mode mode, QObject *parent)
+	: QObject(parent), game_path(game_path), mode(asset_prefetcher::is_supported() ? mode : prefetch_mode::off)
+{
+	this->thread_pool.setMaxThreadCount(asset_prefetcher::io_thread_count);
+}
+
+asset_prefetcher::~asset_prefetcher()
+{
+	this->cancel();
+	this->future.waitForFinished();
+
+#ifdef __linux__
+	if (this->inotify_fd != -1) {
+		::close(this->inotify_fd);
+	}
+#endif
+}
+
+void asset_prefetcher::start()
+{
+	if (this->mode == prefetch_mode::off || this->future.isRunning()) {
+		return;
+	}
+
+	this->cancelled = false;
+
+	this->future = QtConcurrent::run(&this->thread_pool, [this]() {
+		try {
+			trace_span span("prefetch_assets", "prefetch");
+			const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+			const std::vector<std::filesystem::path> files = this->build_manifest();
+			this->prefetch_files(files);
+
+			if (!this->cancelled) {
+				const int64_t duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+				log("Prefetched " + std::to_string(files.size()) + " game files in " + std::to_string(duration_ms) + " ms.");
+			}
+		} catch (const std::exception &exception) {
+			report_exception(exception);
+		}
+	});
+}
+
+void asset_prefetcher::cancel()
+{
+	this->cancelled = true;
+}
+
+void asset_prefetcher::start_recording()
+{
+	if (this->mode != prefetch_mode::recorded || this->inotify_fd != -1) {
+		return;
+	}
+
+	this->recorded_files.clear();
+	this->recorded_file_set.clear();
+	this->watched_directories.clear();
+	this->recording_overflowed = false;
+
+#ifdef __linux__
+	//files are recorded when they are read rather than opened, since the prefetcher opens them too, but only gives the kernel read-ahead hints for them
+	//this catches every read as it happens, whereas sampling the game's open file descriptors would miss the files which are opened and closed between samples
+	//inotify cannot tell which process read a file, so reads of the data files by other processes while the game runs, e.g. by file indexers or backup tools, are recorded as well; this only makes the next prefetch include some files the game may not need
+	//inotify also does not report accesses through memory mapping, so files the game only maps are not recorded, and are prefetched with the rest of their directory instead
+	this->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (this->inotify_fd == -1) {
+		log_error("Failed to initialize inotify for recording the game's files.");
+		return;
+	}
+
+	for (const char *dir_name : asset_prefetcher::priority_directories) {
+		const std::filesystem::path dir_path = this->game_path / dir_name;
+
+		std::error_code error_code;
+		if (!std::filesystem::is_directory(dir_path, error_code)) {
+			continue;
+		}
+
+		//inotify watches are not recursive, so each subdirectory needs its own watch
+		this->watch_directory(dir_path);
+
+		for (std::filesystem::recursive_directory_iterator dir_iterator(dir_path, std::filesystem::directory_options::skip_permission_denied, error_code), end_iterator; dir_iterator != end_iterator; dir_iterator.increment(error_code)) {
+			if (error_code) {
+				break;
+			}
+
+			if (dir_iterator->is_directory(error_code)) {
+				this->watch_directory(dir_iterator->path());
+			}
+		}
+	}
+
+	this->inotify_notifier = new QSocketNotifier(this->inotify_fd, QSocketNotifier::Read, this);
+	connect(this->inotify_notifier, &QSocketNotifier::activated, this, &asset_prefetcher::record_read_files);
+#endif
+}
+
+void asset_prefetcher::stop_recording()
+{
+	if (this->inotify_fd == -1) {
+		return;
+	}
+
+	//take the events which have not been processed yet
+	this->record_read_files();
+
+	delete this->inotify_notifier;
+	this->inotify_notifier = nullptr;
+
+#ifdef __linux__
+	::close(this->inotify_fd);
+#endif
+	this->inotify_fd = -1;
+	this->watched_directories.clear();
+
+	if (this->recorded_files.empty()) {
+		return;
+	}
+
+	try {
+		const std::filesystem::path filepath = asset_prefetcher::get_recorded_files_filepath();
+
+		std::ofstream ofstream(filepath, std::ios::binary | std::ios::trunc);
+
+		if (!ofstream) {
+			throw std::runtime_error("Failed to open file \"" + to_string(filepath) + "\" for writing.");
+		}
+
+		for (const std::string &relative_filepath : this->recorded_files) {
+			ofstream << relative_filepath << '\n';
+		}
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+	}
+}
+
+std::vector<std::filesystem::path> asset_prefetcher::build_manifest() const
+{
+#ifdef __linux__
+	set_idle_io_priority();
+#endif
+
+	std::vector<std::filesystem::path> files;
+	std::set<std::filesystem::path> added_files;
+	uint64_t total_size = 0;
+
+	const auto add_file = [&](const std::filesystem::path &filepath, const uint64_t size) {
+		if (total_size + size > asset_prefetcher::max_prefetch_size || added_files.contains(filepath)) {
+			return;
+		}
+
+		files.push_back(filepath);
+		added_files.insert(filepath);
+		total_size += size;
+	};
+
+	//the files the game opened in the previous session come first, since they are the ones it is known to need
+	if (this->mode == prefetch_mode::recorded) {
+		for (const std::filesystem::path &filepath : this->load_recorded_files()) {
+			if (this->cancelled) {
+				return files;
+			}
+
+			std::error_code error_code;
+			const uintmax_t size = std::filesystem::file_size(filepath, error_code);
+
+			if (!error_code) {
+				add_file(filepath, size);
+			}
+		}
+	}
+
+	for (const char *dir_name : asset_prefetcher::priority_directories) {
+		const std::filesystem::path dir_path = this->game_path / dir_name;
+
+		std::error_code error_code;
+		if (!std::filesystem::is_directory(dir_path, error_code)) {
+			continue;
+		}
+
+		for (std::filesystem::recursive_directory_iterator dir_iterator(dir_path, std::filesystem::directory_options::skip_permission_denied, error_code), end_iterator; dir_iterator != end_iterator; dir_iterator.increment(error_code)) {
+			if (this->cancelled || error_code || total_size >= asset_prefetcher::max_prefetch_size) {
+				break;
+			}
+
+			if (dir_iterator->is_regular_file(error_code)) {
+				add_file(dir_iterator->path(), dir_iterator->file_size(error_code));
+			}
+		}
+	}
+
+	return files;
+}
+
+std::vector<std::filesystem::path> asset_prefetcher::load_recorded_files() const
+{
+	std::vector<std::filesystem::path> files;
+
+	std::ifstream ifstream(asset_prefetcher::get_recorded_files_filepath());
+
+	std::string line;
+	while (std::getline(ifstream, line)) {
+		if (!line.empty()) {
+			files.push_back(this->game_path / std::filesystem::path(line));
+		}
+	}
+
+	return files;
+}
+
+void asset_prefetcher::prefetch_files(const std::vector<std::filesystem::path> &files)
+{
+#ifdef __linux__
+	std::atomic<size_t> next_file_index = 0;
+
+	const auto prefetch_next_files = [this, &files, &next_file_index]() {
+		set_idle_io_priority();
+		QThread::currentThread()->setPriority(QThread::IdlePriority);
+
+		while (!this->cancelled) {
+			const size_t index = next_file_index.fetch_add(1);
+			if (index >= files.size()) {
+				break;
+			}
+
+			prefetch_file(files[index]);
+		}
+	};
+
+	//the files are taken in order by all the threads, so that the ones with the highest priority are read first
+	std::vector<QFuture<void>> futures;
+	for (int i = 1; i < asset_prefetcher::io_thread_count; ++i) {
+		futures.push_back(QtConcurrent::run(&this->thread_pool, prefetch_next_files));
+	}
+
+	prefetch_next_files();
+
+	for (QFuture<void> &future : futures) {
+		future.waitForFinished();
+	}
+#else
+	Q_UNUSED(files)
+#endif
+}
+
+void asset_prefetcher::watch_directory(const std::filesystem::path &dir_path)
+{
+#ifdef __linux__
+	const int watch_descriptor = inotify_add_watch(this->inotify_fd, dir_path.c_str(), IN_ACCESS | IN_ONLYDIR);
+	if (watch_descriptor == -1) {
+		log_error("Failed to watch directory \"" + to_string(dir_path) + "\" for recording the game's files.");
+		return;
+	}
+
+	this->watched_directories[watch_descriptor] = dir_path.lexically_relative(this->game_path).generic_string();
+#else
+	Q_UNUSED(dir_path)
+#endif
+}
+
+void asset_prefetcher::record_read_files()
+{
+#ifdef __linux__
+	alignas(inotify_event) char buffer[asset_prefetcher::recording_buffer_size];
+
+	while (true) {
+		const ssize_t length = ::read(this->inotify_fd, buffer, sizeof(buffer));
+		if (length <= 0) {
+			break;
+		}
+
+		for (const char *event_ptr = buffer; event_ptr < buffer + length;) {
+			const inotify_event *event = reinterpret_cast<const inotify_event *>(event_ptr);
+			event_ptr += sizeof(inotify_event) + event->len;
+
+			if ((event->mask & IN_Q_OVERFLOW) != 0) {
+				if (!this->recording_overflowed) {
+					this->recording_overflowed = true;
+					log_error("Events were lost while recording the game's files, so the recording is incomplete.");
+				}
+
+				continue;
+			}
+
+			if ((event->mask & IN_ISDIR) != 0 || event->len == 0) {
+				continue;
+			}
+
+			const auto find_iterator = this->watched_directories.find(event->wd);
+			if (find_iterator == this->watched_directories.end()) {
+				continue;
+			}
+
+			const std::string relative_path_str = find_iterator->second + '/' + event->name;
+			if (this->recorded_file_set.insert(relative_path_str).second) {
+				this->recorded_files.push_back(relative_path_str);
+			}
+		}
+	}
+#endif
+}
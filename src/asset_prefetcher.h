@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QFuture>
+#include <QObject>
+#include <QThreadPool>
+
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+enum class prefetch_mode {
+	off,
+	directories, //prefetch the files of the game's data directories, in order of priority
+	recorded //record the data files read while the game runs, and prefetch those first the next time
+};
+
+prefetch_mode string_to_prefetch_mode(const std::string &str);
+
+class QSocketNotifier;
+
+//reads the game's data files into the page cache while the game is starting, so that its loading does not have to wait as much for the disk
+//the reads are done with idle I/O priority, so that they do not compete with the game's own reads
+class asset_prefetcher final : public QObject
+{
+	Q_OBJECT
+
+public:
+	static constexpr int io_thread_count = 2;
+	static constexpr uint64_t max_prefetch_size = 512 * 1024 * 1024; //the maximum amount of data prefetched, so that the page cache is not flooded
+	static constexpr size_t recording_buffer_size = 64 * 1024;
+
+	//the data directories, in the order in which the game loads them
+	static constexpr std::array<const char *, 8> priority_directories = {
+		"scripts",
+		"interface",
+		"translations",
+		"graphics/interface",
+		"graphics/cursors",
+		"graphics",
+		"sounds",
+		"music"
+	};
+
+	static bool is_supported();
+	static std::filesystem::path get_recorded_files_filepath();
+
+	explicit asset_prefetcher(const std::filesystem::path &game_path, const prefetch_mode mode, QObject *parent = nullptr);
+	~asset_prefetcher();
+
+	//start prefetching; does nothing if a prefetch is still running, including one which has been cancelled but has not stopped yet
+	void start();
+
+	//stop prefetching at the next file; this does not wait for the prefetch to stop, so that the GUI thread is not blocked by a slow file system
+	void cancel();
+
+	//record the game data files read while the game is running; reads by other processes while the game runs are recorded as well, and reads through memory mapping are not
+	void start_recording();
+
+	//stop recording, and save the recorded files for the next prefetch
+	void stop_recording();
+
+private:
+	std::vector<std::filesystem::path> build_manifest() const;
+	std::vector<std::filesystem::path> load_recorded_files() const;
+	void prefetch_files(const std::vector<std::filesystem::path> &files);
+	void watch_directory(const std::filesystem::path &dir_path);
+	void record_read_files();
+
+private:
+	std::filesystem::path game_path;
+	prefetch_mode mode = prefetch_mode::off;
+	QThreadPool thread_pool;
+	QFuture<void> future;
+	std::atomic<bool> cancelled = false;
+	int inotify_fd = -1; //the inotify instance watching the data directories while recording, or -1 if not recording
+	QSocketNotifier *inotify_notifier = nullptr;
+	std::map<int, std::string> watched_directories; //the relative paths of the watched data directories, mapped to their watch descriptors
+	bool recording_overflowed = false;
+	std::vector<std::string> recorded_files; //the relative paths of the files read by the game, in the order in which they were first read
+	std::set<std::string> recorded_file_set;
+};
@@ -0,0 +1,393 @@
+#include "achievement_manager.h"
+#include "fake_steam_backend.h"
+#include "mod_manager.h"
+#include "util.h"
+#include "workshop_subscription_manager.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+//benchmark for the achievement synchronization, mod upload and Workshop subscription sync paths, run against the fake Steam backend
+
+struct benchmark_settings final
+{
+	int iterations = 20;
+	fake_steam_backend::settings steam_settings;
+};
+
+static void print_result(const std::string &name, std::vector<std::chrono::nanoseconds> &durations, const uint64_t units_per_iteration, const std::string &unit_name)
+{
+	if (durations.empty()) {
+		return;
+	}
+
+	std::sort(durations.begin(), durations.end());
+
+	std::chrono::nanoseconds total_duration(0);
+	for (const std::chrono::nanoseconds &duration : durations) {
+		total_duration += duration;
+	}
+
+	const auto get_percentile = [&durations](const size_t percentile) {
+		const size_t index = std::min(durations.size() - 1, durations.size() * percentile / 100);
+		return std::chrono::duration<double, std::micro>(durations[index]).count();
+	};
+
+	const double total_seconds = std::chrono::duration<double>(total_duration).count();
+	const double throughput = total_seconds > 0 ? static_cast<double>(units_per_iteration * durations.size()) / total_seconds : 0;
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << std::left << std::setw(48) << name << std::right;
+	std::cout << " p50: " << std::setw(10) << get_percentile(50) << " us";
+	std::cout << " p90: " << std::setw(10) << get_percentile(90) << " us";
+	std::cout << " p99: " << std::setw(10) << get_percentile(99) << " us";
+	std::cout << " max: " << std::setw(10) << std::chrono::duration<double, std::micro>(durations.back()).count() << " us";
+	std::cout << " throughput: " << std::setw(12) << throughput << " " << unit_name << "/s";
+	std::cout << '\n';
+}
+
+template <typename function_type>
+static std::chrono::nanoseconds measure(const function_type &function)
+{
+	const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::steady_clock::now() - start_time;
+}
+
+static fake_steam_backend *reset_steam_backend(const benchmark_settings &settings)
+{
+	steam_backend::set(std::make_unique<fake_steam_backend>(settings.steam_settings));
+	return static_cast<fake_steam_backend *>(steam_backend::get());
+}
+
+static void write_achievement_file(const std::filesystem::path &filepath, const bool log_format, const int key_count, const std::filesystem::file_time_type modified_time)
+{
+	std::ofstream ofstream(filepath, std::ios::binary | std::ios::trunc);
+
+	if (log_format) {
+		ofstream << "wyrmsun-achievements 1\n";
+	} else {
+		ofstream << "[General]\n";
+	}
+
+	for (int i = 0; i < key_count; ++i) {
+		ofstream << "achievement_" << i << (log_format ? "\n" : "=true\n");
+	}
+
+	ofstream.close();
+	std::filesystem::last_write_time(filepath, modified_time);
+}
+
+static void append_achievement(const std::filesystem::path &filepath, const bool log_format, const int key_index, const std::filesystem::file_time_type modified_time)
+{
+	std::ofstream ofstream(filepath, std::ios::binary | std::ios::app);
+	ofstream << "achievement_" << key_index << (log_format ? "\n" : "=true\n");
+	ofstream.close();
+	std::filesystem::last_write_time(filepath, modified_time);
+}
+
+static void benchmark_achievements(const benchmark_settings &settings, const bool log_format)
+{
+	const std::filesystem::path ini_filepath = achievement_manager::get_achievements_filepath();
+	const std::filesystem::path log_filepath = achievement_manager::get_achievement_log_filepath();
+	const std::filesystem::path &filepath = log_format ? log_filepath : ini_filepath;
+	const std::string format_name = log_format ? "log" : "ini";
+
+	std::filesystem::remove(ini_filepath);
+	std::filesystem::remove(log_filepath);
+
+	for (const int key_count : { 10, 100, 1000, 10000 }) {
+		std::vector<std::chrono::nanoseconds> full_sync_durations;
+		std::vector<std::chrono::nanoseconds> unchanged_durations;
+		std::vector<std::chrono::nanoseconds> new_key_durations;
+
+		for (int i = 0; i < settings.iterations; ++i) {
+			reset_steam_backend(settings);
+
+			std::filesystem::file_time_type modified_time = std::filesystem::file_time_type::clock::now();
+			write_achievement_file(filepath, log_format, key_count, modified_time);
+
+			achievement_manager achievement_manager(false);
+
+			full_sync_durations.push_back(measure([&achievement_manager]() {
+				achievement_manager.check_achievements();
+			}));
+
+			//rewrite the file with the same contents, as the game does when saving without having unlocked anything
+			modified_time += std::chrono::seconds(1);
+			write_achievement_file(filepath, log_format, key_count, modified_time);
+
+			unchanged_durations.push_back(measure([&achievement_manager]() {
+				achievement_manager.check_achievements();
+			}));
+
+			modified_time += std::chrono::seconds(1);
+			append_achievement(filepath, log_format, key_count, modified_time);
+
+			new_key_durations.push_back(measure([&achievement_manager]() {
+				achievement_manager.check_achievements();
+			}));
+		}
+
+		const std::string prefix = "achievements (" + format_name + ", " + std::to_string(key_count) + " keys): ";
+		print_result(prefix + "full sync", full_sync_durations, key_count, "keys");
+		print_result(prefix + "unchanged rewrite", unchanged_durations, key_count, "keys");
+		print_result(prefix + "one new key", new_key_durations, 1, "keys");
+	}
+
+	std::filesystem::remove(filepath);
+}
+
+static void create_mod(const std::filesystem::path &mod_path, const int file_count, const size_t file_size)
+{
+	std::filesystem::create_directories(mod_path / "data");
+
+	std::ofstream(mod_path / "module.txt") << "name=\"Benchmark Mod\"\n";
+
+	const std::string file_data(file_size, 'x');
+
+	for (int i = 0; i < file_count; ++i) {
+		std::ofstream(mod_path / "data" / ("file_" + std::to_string(i) + ".txt"), std::ios::binary) << file_data;
+	}
+}
+
+//process events and the fake backend's callbacks while waiting for an operation, sleeping briefly between rounds instead of spinning
+static void pump_events(fake_steam_backend *steam)
+{
+	static constexpr std::chrono::microseconds pump_interval(100);
+
+	QCoreApplication::processEvents();
+	steam->run_callbacks();
+	std::this_thread::sleep_for(pump_interval);
+}
+
+static std::chrono::nanoseconds upload_mod(mod_manager &mod_manager, const std::filesystem::path &mod_path, fake_steam_backend *steam, bool &success)
+{
+	bool finished = false;
+	success = false;
+
+	const QMetaObject::Connection completed_connection = QObject::connect(&mod_manager, &mod_manager::modUploadCompleted, [&finished, &success]() {
+		finished = true;
+		success = true;
+	});
+
+	const QMetaObject::Connection failed_connection = QObject::connect(&mod_manager, &mod_manager::modUploadFailed, [&finished]() {
+		finished = true;
+	});
+
+	const std::chrono::nanoseconds duration = measure([&]() {
+		mod_manager.upload_mod(QUrl::fromLocalFile(to_qstring(mod_path)));
+
+		while (!finished) {
+			pump_events(steam);
+		}
+	});
+
+	QObject::disconnect(completed_connection);
+	QObject::disconnect(failed_connection);
+
+	return duration;
+}
+
+static void benchmark_mod_upload(const benchmark_settings &settings)
+{
+	static constexpr size_t file_size = 4096;
+
+	const QTemporaryDir temp_dir;
+	if (!temp_dir.isValid()) {
+		throw std::runtime_error("Failed to create a temporary directory for the benchmark mods.");
+	}
+
+	for (const int file_count : { 10, 100, 1000 }) {
+		const std::filesystem::path mod_path = to_path(temp_dir.path()) / ("mod_" + std::to_string(file_count));
+		create_mod(mod_path, file_count, file_size);
+
+		std::vector<std::chrono::nanoseconds> create_durations;
+		std::vector<std::chrono::nanoseconds> update_durations;
+		std::vector<std::chrono::nanoseconds> unchanged_durations;
+		int failure_count = 0;
+
+		fake_steam_backend *steam = reset_steam_backend(settings);
+		mod_manager mod_manager;
+
+		for (int i = 0; i < settings.iterations; ++i) {
+			bool success = false;
+
+			//remove the mod ID and manifest files, so that a new item is created, and all files are hashed
+			std::filesystem::remove(mod_path / "mod_id.txt");
+			std::filesystem::remove(mod_manifest::get_filepath(mod_path));
+			create_durations.push_back(upload_mod(mod_manager, mod_path, steam, success));
+			if (!success) {
+				++failure_count;
+			}
+
+			//change a single file, so that the update only needs to hash that file again
+			std::ofstream(mod_path / "data" / "file_0.txt", std::ios::binary | std::ios::app) << i;
+			update_durations.push_back(upload_mod(mod_manager, mod_path, steam, success));
+			if (!success) {
+				++failure_count;
+			}
+
+			unchanged_durations.push_back(upload_mod(mod_manager, mod_path, steam, success));
+			if (!success) {
+				++failure_count;
+			}
+		}
+
+		const uint64_t mod_size = static_cast<uint64_t>(file_count) * file_size;
+		const std::string prefix = "mod upload (" + std::to_string(file_count) + " files): ";
+		print_result(prefix + "create", create_durations, mod_size, "bytes");
+		print_result(prefix + "update (one file changed)", update_durations, mod_size, "bytes");
+		print_result(prefix + "unchanged", unchanged_durations, mod_size, "bytes");
+
+		if (failure_count > 0) {
+			std::cout << prefix << failure_count << " uploads failed\n";
+		}
+	}
+}
+
+static std::chrono::nanoseconds sync_workshop_items(workshop_subscription_manager &subscription_manager, fake_steam_backend *steam)
+{
+	return measure([&subscription_manager, steam]() {
+		subscription_manager.sync();
+
+		while (subscription_manager.is_syncing()) {
+			pump_events(steam);
+		}
+	});
+}
+
+static benchmark_settings create_workshop_settings(const benchmark_settings &settings, const int item_count, const int outdated_interval)
+{
+	static constexpr uint64_t item_size = 1024 * 1024;
+
+	benchmark_settings workshop_settings = settings;
+
+	for (int i = 0; i < item_count; ++i) {
+		fake_steam_backend::workshop_item item;
+		item.published_file_id = static_cast<PublishedFileId_t>(i + 1);
+		item.size = item_size;
+		item.timestamp = 2;
+
+		//with an interval of 0, no item is installed
+		if (outdated_interval != 0) {
+			item.installed_timestamp = i % outdated_interval == 0 ? 1 : 2;
+		}
+
+		workshop_settings.steam_settings.subscribed_items.push_back(item);
+	}
+
+	return workshop_settings;
+}
+
+static void benchmark_workshop_sync(const benchmark_settings &settings)
+{
+	for (const int item_count : { 10, 100, 1000 }) {
+		std::vector<std::chrono::nanoseconds> initial_durations;
+		std::vector<std::chrono::nanoseconds> unchanged_durations;
+		std::vector<std::chrono::nanoseconds> outdated_durations;
+		int failure_count = 0;
+
+		for (int i = 0; i < settings.iterations; ++i) {
+			std::filesystem::remove(workshop_subscription_manager::get_cache_filepath());
+
+			{
+				fake_steam_backend *steam = reset_steam_backend(create_workshop_settings(settings, item_count, 0));
+				workshop_subscription_manager subscription_manager;
+
+				initial_durations.push_back(sync_workshop_items(subscription_manager, steam));
+				failure_count += subscription_manager.get_failed_download_count();
+
+				//all items are installed now, so only their states need to be checked
+				unchanged_durations.push_back(sync_workshop_items(subscription_manager, steam));
+				failure_count += subscription_manager.get_failed_download_count();
+			}
+
+			{
+				//every tenth item has an update
+				fake_steam_backend *steam = reset_steam_backend(create_workshop_settings(settings, item_count, 10));
+				workshop_subscription_manager subscription_manager;
+
+				outdated_durations.push_back(sync_workshop_items(subscription_manager, steam));
+				failure_count += subscription_manager.get_failed_download_count();
+			}
+		}
+
+		const std::string prefix = "workshop sync (" + std::to_string(item_count) + " items): ";
+		print_result(prefix + "initial", initial_durations, item_count, "items");
+		print_result(prefix + "unchanged", unchanged_durations, item_count, "items");
+		print_result(prefix + "10% outdated", outdated_durations, item_count, "items");
+
+		if (failure_count > 0) {
+			std::cout << prefix << failure_count << " downloads failed\n";
+		}
+	}
+
+	std::filesystem::remove(workshop_subscription_manager::get_cache_filepath());
+}
+
+int main(int argc, char **argv)
+{
+	QCoreApplication app(argc, argv);
+	app.setApplicationName("Wyrmsun");
+	app.setOrganizationName("Wyrmsun");
+
+	//use a separate user data directory, so that the benchmark does not touch the player's achievements
+	QStandardPaths::setTestModeEnabled(true);
+
+	int result = 0;
+
+	try {
+		QCommandLineParser cmd_parser;
+		cmd_parser.addHelpOption();
+
+		const QCommandLineOption iterations_option("iterations", "The number of iterations for each benchmark.", "count", "20");
+		cmd_parser.addOption(iterations_option);
+
+		const QCommandLineOption call_latency_option("call-latency", "The latency of each synchronous Steam call, in microseconds.", "us", "0");
+		cmd_parser.addOption(call_latency_option);
+
+		const QCommandLineOption call_result_latency_option("call-result-latency", "The latency of each asynchronous Steam call, in microseconds.", "us", "0");
+		cmd_parser.addOption(call_result_latency_option);
+
+		const QCommandLineOption upload_speed_option("upload-speed", "The simulated upload speed, in bytes per second, with 0 meaning unlimited.", "bytes", "0");
+		cmd_parser.addOption(upload_speed_option);
+
+		const QCommandLineOption download_speed_option("download-speed", "The simulated download speed for subscribed Workshop items, in bytes per second, with 0 meaning unlimited.", "bytes", "0");
+		cmd_parser.addOption(download_speed_option);
+
+		const QCommandLineOption failure_probability_option("failure-probability", "The probability that a Steam call fails.", "probability", "0");
+		cmd_parser.addOption(failure_probability_option);
+
+		cmd_parser.process(app);
+
+		benchmark_settings settings;
+		settings.iterations = std::max(1, cmd_parser.value(iterations_option).toInt());
+		settings.steam_settings.call_latency = std::chrono::microseconds(cmd_parser.value(call_latency_option).toLongLong());
+		settings.steam_settings.call_result_latency = std::chrono::microseconds(cmd_parser.value(call_result_latency_option).toLongLong());
+		settings.steam_settings.upload_bytes_per_second = cmd_parser.value(upload_speed_option).toULongLong();
+		settings.steam_settings.download_bytes_per_second = cmd_parser.value(download_speed_option).toULongLong();
+		settings.steam_settings.failure_probability = cmd_parser.value(failure_probability_option).toDouble();
+
+		benchmark_achievements(settings, false);
+		benchmark_achievements(settings, true);
+		benchmark_mod_upload(settings);
+		benchmark_workshop_sync(settings);
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+		result = -1;
+	}
+
+	steam_backend::set(nullptr);
+
+	return result;
+}
@@ -0,0 +1,508 @@
+#include "fake_steam_backend.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+fake_steam_backend::fake_steam_backend(const settings &config) : config(config), random_engine(config.random_seed)
+{
+	for (const workshop_item &item : config.subscribed_items) {
+		this->workshop_items[item.published_file_id] = item;
+	}
+
+	//the stats are available from the start, so that the backend can be used without requesting them first
+	if (config.user_stats_available) {
+		this->notify_user_stats_received();
+	}
+}
+
+bool fake_steam_backend::init()
+{
+	return true;
+}
+
+void fake_steam_backend::shutdown()
+{
+	this->pending_calls.clear();
+	this->item_downloads.clear();
+}
+
+void fake_steam_backend::run_callbacks()
+{
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	//take the calls which are due out of the list before running them, as the functions may issue further calls
+	std::vector<pending_call> due_calls;
+
+	for (size_t i = 0; i < this->pending_calls.size();) {
+		if (this->pending_calls[i].completion_time <= now) {
+			due_calls.push_back(std::move(this->pending_calls[i]));
+			this->pending_calls.erase(this->pending_calls.begin() + i);
+		} else {
+			++i;
+		}
+	}
+
+	for (const pending_call &call : due_calls) {
+		++this->call_counters.completed_calls;
+		this->on_callback_dispatched();
+		call.function();
+	}
+}
+
+size_t fake_steam_backend::get_pending_call_count() const
+{
+	return this->pending_calls.size();
+}
+
+bool fake_steam_backend::is_user_stats_available() const
+{
+	return this->config.user_stats_available;
+}
+
+bool fake_steam_backend::request_current_stats()
+{
+	if (!this->perform_call()) {
+		return false;
+	}
+
+	this->add_pending_call(this->config.call_result_latency, [this]() {
+		this->notify_user_stats_received();
+	});
+
+	return true;
+}
+
+bool fake_steam_backend::get_achievement(const char *name, bool *achieved)
+{
+	if (!this->perform_call()) {
+		return false;
+	}
+
+	if (!this->config.registered_achievements.empty() && !this->config.registered_achievements.contains(name)) {
+		return false;
+	}
+
+	*achieved = this->unlocked_achievements.contains(name);
+	return true;
+}
+
+bool fake_steam_backend::is_achievement_registered(const char *name)
+{
+	//only a schema lookup, so no failure is injected for it, and a failed get_achievement() call stays distinguishable from a missing achievement
+	++this->call_counters.synchronous_calls;
+
+	if (this->config.call_latency.count() > 0) {
+		std::this_thread::sleep_for(this->config.call_latency);
+	}
+
+	return this->config.registered_achievements.empty() || this->config.registered_achievements.contains(name);
+}
+
+bool fake_steam_backend::set_achievement(const char *name)
+{
+	if (!this->perform_call()) {
+		return false;
+	}
+
+	this->unlocked_achievements.insert(name);
+	return true;
+}
+
+bool fake_steam_backend::clear_achievement(const char *name)
+{
+	if (!this->perform_call()) {
+		return false;
+	}
+
+	const auto find_iterator = this->unlocked_achievements.find(std::string_view(name));
+	if (find_iterator != this->unlocked_achievements.end()) {
+		this->unlocked_achievements.erase(find_iterator);
+	}
+
+	return true;
+}
+
+bool fake_steam_backend::set_stat(const char *name, const int32 value)
+{
+	if (!this->perform_call()) {
+		return false;
+	}
+
+	this->stat_values[name] = value;
+	return true;
+}
+
+bool fake_steam_backend::indicate_achievement_progress(const char *name, const uint32 current_progress, const uint32 max_progress)
+{
+	++this->call_counters.progress_indications;
+
+	if (!this->perform_call()) {
+		return false;
+	}
+
+	//like Steam, refuse to show the progress of unlocked achievements, or progress which would be complete
+	return !this->unlocked_achievements.contains(name) && current_progress < max_progress;
+}
+
+bool fake_steam_backend::store_stats()
+{
+	++this->call_counters.store_stats_calls;
+
+	if (!this->perform_call()) {
+		return false;
+	}
+
+	//the stats are stored asynchronously, and the store can fail after having been requested
+	const EResult result = this->should_fail() ? k_EResultFail : k_EResultOK;
+
+	this->add_pending_call(this->config.call_result_latency, [this, result]() {
+		this->notify_user_stats_stored(result);
+	});
+
+	return true;
+}
+
+bool fake_steam_backend::is_ugc_available() const
+{
+	return this->config.ugc_available;
+}
+
+void fake_steam_backend::create_item(const AppId_t app_id, const EWorkshopFileType file_type, call_result_function<CreateItemResult_t> &&function)
+{
+	Q_UNUSED(app_id)
+	Q_UNUSED(file_type)
+
+	++this->call_counters.asynchronous_calls;
+
+	const bool failed = this->should_fail();
+	const PublishedFileId_t published_file_id = failed ? 0 : this->next_published_file_id++;
+
+	this->add_pending_call(this->config.call_result_latency, [function = steam_backend::trace_call_result("CreateItem", std::move(function)), failed, published_file_id]() {
+		CreateItemResult_t result{};
+		result.m_eResult = failed ? k_EResultFail : k_EResultOK;
+		result.m_nPublishedFileId = published_file_id;
+		result.m_bUserNeedsToAcceptWorkshopLegalAgreement = false;
+		function(&result, false);
+	});
+}
+
+UGCUpdateHandle_t fake_steam_backend::start_item_update(const AppId_t app_id, const PublishedFileId_t published_file_id)
+{
+	Q_UNUSED(app_id)
+
+	if (!this->perform_call()) {
+		return k_UGCUpdateHandleInvalid;
+	}
+
+	const UGCUpdateHandle_t update_handle = this->next_update_handle++;
+	this->item_updates[update_handle].published_file_id = published_file_id;
+	return update_handle;
+}
+
+bool fake_steam_backend::set_item_title(const UGCUpdateHandle_t update_handle, const char *title)
+{
+	if (!this->perform_call() || !this->item_updates.contains(update_handle)) {
+		return false;
+	}
+
+	this->item_updates[update_handle].title = title;
+	return true;
+}
+
+bool fake_steam_backend::set_item_content(const UGCUpdateHandle_t update_handle, const char *content_folder)
+{
+	if (!this->perform_call() || !this->item_updates.contains(update_handle)) {
+		return false;
+	}
+
+	this->item_updates[update_handle].content_folder = content_folder;
+	return true;
+}
+
+bool fake_steam_backend::set_item_preview(const UGCUpdateHandle_t update_handle, const char *preview_file)
+{
+	if (!this->perform_call() || !this->item_updates.contains(update_handle)) {
+		return false;
+	}
+
+	this->item_updates[update_handle].preview_file = preview_file;
+	return true;
+}
+
+void fake_steam_backend::submit_item_update(const UGCUpdateHandle_t update_handle, const char *change_note, call_result_function<SubmitItemUpdateResult_t> &&function)
+{
+	Q_UNUSED(change_note)
+
+	++this->call_counters.asynchronous_calls;
+
+	const auto find_iterator = this->item_updates.find(update_handle);
+	const bool failed = find_iterator == this->item_updates.end() || this->should_fail();
+
+	uint64_t upload_size = 0;
+	PublishedFileId_t published_file_id = 0;
+
+	if (find_iterator != this->item_updates.end()) {
+		const item_update &item_update = find_iterator->second;
+		published_file_id = item_update.published_file_id;
+
+		//like Steam, go through the content folder when the update is submitted
+		if (!item_update.content_folder.empty()) {
+			for (const std::filesystem::directory_entry &dir_entry : std::filesystem::recursive_directory_iterator(item_update.content_folder)) {
+				if (dir_entry.is_regular_file()) {
+					upload_size += dir_entry.file_size();
+				}
+			}
+		}
+
+		if (!item_update.preview_file.empty()) {
+			std::error_code error_code;
+			const uintmax_t preview_size = std::filesystem::file_size(item_update.preview_file, error_code);
+			if (!error_code) {
+				upload_size += preview_size;
+			}
+		}
+
+		this->item_updates.erase(find_iterator);
+	}
+
+	std::chrono::microseconds latency = this->config.call_result_latency;
+	if (!failed && this->config.upload_bytes_per_second != 0) {
+		latency += std::chrono::microseconds(upload_size * 1000000 / this->config.upload_bytes_per_second);
+	}
+
+	if (!failed) {
+		this->call_counters.uploaded_bytes += upload_size;
+
+		submitted_update &submitted_update = this->submitted_updates[update_handle];
+		submitted_update.start_time = std::chrono::steady_clock::now();
+		submitted_update.duration = latency;
+		submitted_update.size = upload_size;
+	}
+
+	this->add_pending_call(latency, [this, function = steam_backend::trace_call_result("SubmitItemUpdate", std::move(function)), update_handle, failed, published_file_id]() {
+		this->submitted_updates.erase(update_handle);
+
+		SubmitItemUpdateResult_t result{};
+		result.m_eResult = failed ? k_EResultFail : k_EResultOK;
+		result.m_bUserNeedsToAcceptWorkshopLegalAgreement = false;
+		result.m_nPublishedFileId = published_file_id;
+		function(&result, false);
+	});
+}
+
+EItemUpdateStatus fake_steam_backend::get_item_update_progress(const UGCUpdateHandle_t update_handle, uint64 *bytes_processed, uint64 *bytes_total)
+{
+	++this->call_counters.synchronous_calls;
+
+	const auto find_iterator = this->submitted_updates.find(update_handle);
+	if (find_iterator == this->submitted_updates.end()) {
+		return k_EItemUpdateStatusInvalid;
+	}
+
+	const submitted_update &submitted_update = find_iterator->second;
+	const std::chrono::steady_clock::duration elapsed_time = std::chrono::steady_clock::now() - submitted_update.start_time;
+
+	*bytes_total = submitted_update.size;
+
+	if (submitted_update.duration.count() <= 0 || elapsed_time >= submitted_update.duration) {
+		*bytes_processed = submitted_update.size;
+	} else {
+		*bytes_processed = static_cast<uint64>(static_cast<double>(submitted_update.size) * std::chrono::duration<double>(elapsed_time) / std::chrono::duration<double>(submitted_update.duration));
+	}
+
+	return k_EItemUpdateStatusUploadingContent;
+}
+
+uint32 fake_steam_backend::get_num_subscribed_items()
+{
+	++this->call_counters.synchronous_calls;
+	return static_cast<uint32>(this->workshop_items.size());
+}
+
+uint32 fake_steam_backend::get_subscribed_items(PublishedFileId_t *published_file_ids, const uint32 max_entries)
+{
+	++this->call_counters.synchronous_calls;
+
+	uint32 count = 0;
+	for (const auto &[published_file_id, item] : this->workshop_items) {
+		if (count == max_entries) {
+			break;
+		}
+
+		published_file_ids[count++] = published_file_id;
+	}
+
+	return count;
+}
+
+uint32 fake_steam_backend::get_item_state(const PublishedFileId_t published_file_id)
+{
+	++this->call_counters.synchronous_calls;
+
+	const auto find_iterator = this->workshop_items.find(published_file_id);
+	if (find_iterator == this->workshop_items.end()) {
+		return k_EItemStateNone;
+	}
+
+	const workshop_item &item = find_iterator->second;
+	uint32 state = k_EItemStateSubscribed;
+
+	if (item.installed_timestamp != 0) {
+		state |= k_EItemStateInstalled;
+
+		if (item.installed_timestamp != item.timestamp) {
+			state |= k_EItemStateNeedsUpdate;
+		}
+	}
+
+	const auto download_iterator = this->item_downloads.find(published_file_id);
+	if (download_iterator != this->item_downloads.end()) {
+		state |= download_iterator->second.start_time <= std::chrono::steady_clock::now() ? k_EItemStateDownloading : k_EItemStateDownloadPending;
+	}
+
+	return state;
+}
+
+bool fake_steam_backend::get_item_install_info(const PublishedFileId_t published_file_id, uint64 *size_on_disk, char *folder, const uint32 folder_size, uint32 *timestamp)
+{
+	if (!this->perform_call()) {
+		return false;
+	}
+
+	const auto find_iterator = this->workshop_items.find(published_file_id);
+	if (find_iterator == this->workshop_items.end() || find_iterator->second.installed_timestamp == 0) {
+		return false;
+	}
+
+	const workshop_item &item = find_iterator->second;
+	*size_on_disk = item.size;
+	*timestamp = item.installed_timestamp;
+
+	if (folder_size > 0) {
+		const std::string folder_str = "workshop/content/" + std::to_string(published_file_id);
+		const size_t length = std::min<size_t>(folder_str.size(), folder_size - 1);
+		std::memcpy(folder, folder_str.data(), length);
+		folder[length] = '\0';
+	}
+
+	return true;
+}
+
+bool fake_steam_backend::get_item_download_info(const PublishedFileId_t published_file_id, uint64 *bytes_downloaded, uint64 *bytes_total)
+{
+	++this->call_counters.synchronous_calls;
+
+	const auto find_iterator = this->item_downloads.find(published_file_id);
+	if (find_iterator == this->item_downloads.end()) {
+		return false;
+	}
+
+	const item_download &item_download = find_iterator->second;
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	*bytes_total = item_download.size;
+
+	if (now < item_download.start_time) {
+		*bytes_downloaded = 0;
+	} else if (item_download.duration.count() <= 0 || now - item_download.start_time >= item_download.duration) {
+		*bytes_downloaded = item_download.size;
+	} else {
+		*bytes_downloaded = static_cast<uint64>(static_cast<double>(item_download.size) * std::chrono::duration<double>(now - item_download.start_time) / std::chrono::duration<double>(item_download.duration));
+	}
+
+	return true;
+}
+
+bool fake_steam_backend::download_item(const PublishedFileId_t published_file_id, const bool high_priority)
+{
+	++this->call_counters.download_requests;
+
+	if (!this->perform_call()) {
+		return false;
+	}
+
+	const auto find_iterator = this->workshop_items.find(published_file_id);
+	if (find_iterator == this->workshop_items.end()) {
+		return false;
+	}
+
+	//a download which has already been queued is left as it is
+	if (this->item_downloads.contains(published_file_id)) {
+		return true;
+	}
+
+	const workshop_item &item = find_iterator->second;
+
+	//like the Steam client, download the items one after the other, in the order in which they were requested, except that high priority downloads start right away
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	const std::chrono::steady_clock::time_point start_time = high_priority ? now : std::max(now, this->download_queue_end_time);
+
+	std::chrono::microseconds duration(0);
+	if (this->config.download_bytes_per_second != 0) {
+		duration = std::chrono::microseconds(item.size * 1000000 / this->config.download_bytes_per_second);
+	}
+
+	this->download_queue_end_time = std::max(this->download_queue_end_time, start_time + duration);
+
+	item_download &item_download = this->item_downloads[published_file_id];
+	item_download.start_time = start_time;
+	item_download.duration = duration;
+	item_download.size = item.size;
+
+	const bool failed = this->should_fail();
+	const std::chrono::microseconds latency = this->config.call_result_latency + std::chrono::duration_cast<std::chrono::microseconds>(start_time - now) + duration;
+
+	this->add_pending_call(latency, [this, published_file_id, failed]() {
+		this->item_downloads.erase(published_file_id);
+
+		if (!failed) {
+			workshop_item &item = this->workshop_items[published_file_id];
+			item.installed_timestamp = item.timestamp;
+			this->call_counters.downloaded_bytes += item.size;
+		}
+
+		this->notify_item_downloaded(published_file_id, failed ? k_EResultFail : k_EResultOK);
+	});
+
+	return true;
+}
+
+bool fake_steam_backend::perform_call()
+{
+	++this->call_counters.synchronous_calls;
+
+	if (this->config.call_latency.count() > 0) {
+		std::this_thread::sleep_for(this->config.call_latency);
+	}
+
+	return !this->should_fail();
+}
+
+bool fake_steam_backend::should_fail()
+{
+	if (this->config.failure_probability <= 0) {
+		return false;
+	}
+
+	std::bernoulli_distribution distribution(this->config.failure_probability);
+	const bool failed = distribution(this->random_engine);
+
+	if (failed) {
+		++this->call_counters.failed_calls;
+	}
+
+	return failed;
+}
+
+void fake_steam_backend::add_pending_call(const std::chrono::microseconds latency, std::function<void()> &&function)
+{
+	pending_call call;
+	call.completion_time = std::chrono::steady_clock::now() + latency;
+	call.function = std::move(function);
+	this->pending_calls.push_back(std::move(call));
+	this->on_call_issued();
+}
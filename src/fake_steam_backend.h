@@ -0,0 +1,178 @@
+#pragma once
+
+#include "steam_backend.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+//deterministic in-process Steam backend, which simulates the latency and failures of the Steam API without needing a Steam client
+class fake_steam_backend final : public steam_backend
+{
+public:
+	struct workshop_item final
+	{
+		PublishedFileId_t published_file_id = 0;
+		uint64_t size = 0;
+		uint32_t timestamp = 0; //the time at which the item was last updated on the Workshop
+		uint32_t installed_timestamp = 0; //the time at which the installed version of the item was updated, with 0 meaning that it is not installed
+	};
+
+	struct settings final
+	{
+		std::chrono::microseconds call_latency = std::chrono::microseconds(0); //the time each synchronous call takes
+		std::chrono::microseconds call_result_latency = std::chrono::microseconds(0); //the time before an asynchronous call completes
+		uint64_t upload_bytes_per_second = 0; //the simulated upload speed for item content, with 0 meaning that uploads take no time
+		uint64_t download_bytes_per_second = 0; //the simulated download speed for subscribed items, with 0 meaning that downloads take no time
+		double failure_probability = 0; //the probability that a call fails
+		uint32_t random_seed = 0;
+		bool user_stats_available = true;
+		bool ugc_available = true;
+		std::set<std::string, std::less<>> registered_achievements; //if empty, any achievement is considered to be registered
+		std::vector<workshop_item> subscribed_items;
+	};
+
+	struct counters final
+	{
+		uint64_t synchronous_calls = 0;
+		uint64_t asynchronous_calls = 0;
+		uint64_t completed_calls = 0;
+		uint64_t failed_calls = 0;
+		uint64_t store_stats_calls = 0;
+		uint64_t progress_indications = 0;
+		uint64_t uploaded_bytes = 0;
+		uint64_t download_requests = 0;
+		uint64_t downloaded_bytes = 0;
+	};
+
+private:
+	struct item_update final
+	{
+		PublishedFileId_t published_file_id = 0;
+		std::string title;
+		std::string content_folder;
+		std::string preview_file;
+	};
+
+	struct submitted_update final
+	{
+		std::chrono::steady_clock::time_point start_time;
+		std::chrono::microseconds duration;
+		uint64_t size = 0;
+	};
+
+	struct item_download final
+	{
+		std::chrono::steady_clock::time_point start_time;
+		std::chrono::microseconds duration;
+		uint64_t size = 0;
+	};
+
+	struct pending_call final
+	{
+		std::chrono::steady_clock::time_point completion_time;
+		std::function<void()> function;
+	};
+
+public:
+	explicit fake_steam_backend(const settings &config);
+
+	const counters &get_counters() const
+	{
+		return this->call_counters;
+	}
+
+	void reset_counters()
+	{
+		this->call_counters = counters();
+	}
+
+	bool is_achievement_unlocked(const std::string_view name) const
+	{
+		return this->unlocked_achievements.contains(name);
+	}
+
+	//get the value of a stat, or 0 if it has not been set
+	int32 get_stat_value(const std::string_view name) const
+	{
+		const auto find_iterator = this->stat_values.find(name);
+		if (find_iterator == this->stat_values.end()) {
+			return 0;
+		}
+
+		return find_iterator->second;
+	}
+
+	//get the installed version of a subscribed item, or 0 if it is not installed
+	uint32_t get_installed_timestamp(const PublishedFileId_t published_file_id) const
+	{
+		const auto find_iterator = this->workshop_items.find(published_file_id);
+		if (find_iterator == this->workshop_items.end()) {
+			return 0;
+		}
+
+		return find_iterator->second.installed_timestamp;
+	}
+
+	bool has_pending_calls() const
+	{
+		return !this->pending_calls.empty();
+	}
+
+	virtual bool init() override;
+	virtual void shutdown() override;
+	virtual void run_callbacks() override;
+	virtual size_t get_pending_call_count() const override;
+
+	virtual bool is_user_stats_available() const override;
+	virtual bool request_current_stats() override;
+	virtual bool get_achievement(const char *name, bool *achieved) override;
+	virtual bool is_achievement_registered(const char *name) override;
+	virtual bool set_achievement(const char *name) override;
+	virtual bool clear_achievement(const char *name) override;
+	virtual bool set_stat(const char *name, const int32 value) override;
+	virtual bool indicate_achievement_progress(const char *name, const uint32 current_progress, const uint32 max_progress) override;
+	virtual bool store_stats() override;
+
+	virtual bool is_ugc_available() const override;
+	virtual void create_item(const AppId_t app_id, const EWorkshopFileType file_type, call_result_function<CreateItemResult_t> &&function) override;
+	virtual UGCUpdateHandle_t start_item_update(const AppId_t app_id, const PublishedFileId_t published_file_id) override;
+	virtual bool set_item_title(const UGCUpdateHandle_t update_handle, const char *title) override;
+	virtual bool set_item_content(const UGCUpdateHandle_t update_handle, const char *content_folder) override;
+	virtual bool set_item_preview(const UGCUpdateHandle_t update_handle, const char *preview_file) override;
+	virtual void submit_item_update(const UGCUpdateHandle_t update_handle, const char *change_note, call_result_function<SubmitItemUpdateResult_t> &&function) override;
+	virtual EItemUpdateStatus get_item_update_progress(const UGCUpdateHandle_t update_handle, uint64 *bytes_processed, uint64 *bytes_total) override;
+
+	virtual uint32 get_num_subscribed_items() override;
+	virtual uint32 get_subscribed_items(PublishedFileId_t *published_file_ids, const uint32 max_entries) override;
+	virtual uint32 get_item_state(const PublishedFileId_t published_file_id) override;
+	virtual bool get_item_install_info(const PublishedFileId_t published_file_id, uint64 *size_on_disk, char *folder, const uint32 folder_size, uint32 *timestamp) override;
+	virtual bool get_item_download_info(const PublishedFileId_t published_file_id, uint64 *bytes_downloaded, uint64 *bytes_total) override;
+	virtual bool download_item(const PublishedFileId_t published_file_id, const bool high_priority) override;
+
+private:
+	//simulate the latency of a synchronous call, and return whether it succeeded
+	bool perform_call();
+
+	bool should_fail();
+	void add_pending_call(const std::chrono::microseconds latency, std::function<void()> &&function);
+
+private:
+	settings config;
+	counters call_counters;
+	std::mt19937 random_engine;
+	std::set<std::string, std::less<>> unlocked_achievements;
+	std::map<std::string, int32, std::less<>> stat_values;
+	PublishedFileId_t next_published_file_id = 1;
+	UGCUpdateHandle_t next_update_handle = 1;
+	std::map<UGCUpdateHandle_t, item_update> item_updates;
+	std::map<UGCUpdateHandle_t, submitted_update> submitted_updates;
+	std::map<PublishedFileId_t, workshop_item> workshop_items; //the subscribed items, mapped to their IDs
+	std::map<PublishedFileId_t, item_download> item_downloads;
+	std::chrono::steady_clock::time_point download_queue_end_time; //the time at which the queued downloads will have finished
+	std::vector<pending_call> pending_calls;
+};
@@ -0,0 +1,156 @@
+#include "game_event_server.h"
+
+#include "util.h"
+
+#include <QCoreApplication>
+#include <QLocalSocket>
+
+game_event_server::game_event_server(QObject *parent) : QObject(parent)
+{
+	this->server = new QLocalServer(this);
+	this->server->setSocketOptions(QLocalServer::UserAccessOption);
+	connect(this->server, &QLocalServer::newConnection, this, &game_event_server::on_new_connection);
+
+	this->batch_timer = new QTimer(this);
+	this->batch_timer->setSingleShot(true);
+	connect(this->batch_timer, &QTimer::timeout, this, &game_event_server::flush_events);
+}
+
+bool game_event_server::listen()
+{
+	if (this->server->isListening()) {
+		return true;
+	}
+
+	const QString server_name = "wyrmsun_launcher_" + QString::number(QCoreApplication::applicationPid());
+
+	//remove any stale socket file left behind by a launcher process which crashed with the same PID
+	QLocalServer::removeServer(server_name);
+
+	if (!this->server->listen(server_name)) {
+		log_error("Failed to listen for game events: " + this->server->errorString().toStdString());
+		return false;
+	}
+
+	return true;
+}
+
+void game_event_server::on_new_connection()
+{
+	while (QLocalSocket *socket = this->server->nextPendingConnection()) {
+		++this->client_count;
+
+		connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+			this->read_events(socket);
+		});
+
+		connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+			//process any events sent right before disconnecting
+			this->read_events(socket);
+			this->flush_events();
+
+			--this->client_count;
+			socket->deleteLater();
+		});
+
+		emit clientConnected();
+	}
+}
+
+void game_event_server::read_events(QLocalSocket *socket)
+{
+	while (socket->canReadLine()) {
+		QByteArray line = socket->readLine(game_event_server::max_line_length);
+
+		if (!line.endsWith('\n')) {
+			log_error("Received an overly long game event, discarding it.");
+
+			//skip the rest of the line
+			while (!socket->readLine(game_event_server::max_line_length).endsWith('\n')) {
+			}
+
+			continue;
+		}
+
+		this->process_event(line.trimmed());
+	}
+
+	if (!socket->canReadLine() && socket->bytesAvailable() > game_event_server::max_line_length) {
+		log_error("Received an unterminated game event, disconnecting.");
+		socket->abort();
+	}
+}
+
+void game_event_server::process_event(const QByteArray &line)
+{
+	if (line.isEmpty()) {
+		return;
+	}
+
+	const int separator_pos = line.indexOf(' ');
+	const QByteArray event_type = line.left(separator_pos);
+	const QByteArray argument = separator_pos != -1 ? line.mid(separator_pos + 1).trimmed() : QByteArray();
+
+	if (event_type == "achievement" && !argument.isEmpty()) {
+		this->pending_achievements.push_back(argument.toStdString());
+	} else if (event_type == "stat" || event_type == "progress") {
+		if (!this->process_stat_event(event_type, argument)) {
+			log_error("Received an invalid game event: \"" + line.toStdString() + "\".");
+		}
+
+		return;
+	} else {
+		log_error("Received an invalid game event: \"" + line.toStdString() + "\".");
+		return;
+	}
+
+	if (!this->batch_timer->isActive()) {
+		this->batch_timer->start(game_event_server::batch_interval_ms);
+	}
+}
+
+bool game_event_server::process_stat_event(const QByteArray &event_type, const QByteArray &argument)
+{
+	const QList<QByteArray> arguments = argument.split(' ');
+
+	if (event_type == "stat") {
+		if (arguments.size() != 2 || arguments[0].isEmpty()) {
+			return false;
+		}
+
+		bool ok = false;
+		const int32_t value = arguments[1].toInt(&ok);
+		if (!ok) {
+			return false;
+		}
+
+		emit statReceived(arguments[0].toStdString(), value);
+		return true;
+	}
+
+	if (arguments.size() != 3 || arguments[0].isEmpty()) {
+		return false;
+	}
+
+	bool current_ok = false;
+	bool max_ok = false;
+	const uint32_t current_progress = arguments[1].toUInt(&current_ok);
+	const uint32_t max_progress = arguments[2].toUInt(&max_ok);
+	if (!current_ok || !max_ok) {
+		return false;
+	}
+
+	emit achievementProgressReceived(arguments[0].toStdString(), current_progress, max_progress);
+	return true;
+}
+
+void game_event_server::flush_events()
+{
+	this->batch_timer->stop();
+
+	if (!this->pending_achievements.empty()) {
+		const std::vector<std::string> achievements = std::move(this->pending_achievements);
+		this->pending_achievements.clear();
+		emit achievementsReceived(achievements);
+	}
+}
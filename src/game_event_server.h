@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QLocalServer>
+#include <QObject>
+#include <QTimer>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class QLocalSocket;
+
+//local socket server to which the game can send achievement events as they happen, instead of relying on the launcher to detect changes in the achievements file
+//events are newline-terminated UTF-8 lines, e.g. "achievement <key>", "stat <name> <value>" or "progress <key> <current> <max>"
+class game_event_server final : public QObject
+{
+	Q_OBJECT
+
+public:
+	static constexpr const char *environment_variable_name = "WYRMSUN_LAUNCHER_SOCKET";
+	static constexpr int batch_interval_ms = 50; //the time during which received events are gathered before being passed on together
+	static constexpr int max_line_length = 1024;
+
+	explicit game_event_server(QObject *parent = nullptr);
+
+	bool listen();
+
+	QString get_server_name() const
+	{
+		return this->server->fullServerName();
+	}
+
+	bool has_connected_clients() const
+	{
+		return this->client_count > 0;
+	}
+
+signals:
+	void clientConnected();
+	void achievementsReceived(const std::vector<std::string> &keys);
+
+	//stat and progress updates are passed on as they arrive, since the achievement manager coalesces them itself
+	void statReceived(const std::string &name, const int32_t value);
+	void achievementProgressReceived(const std::string &key, const uint32_t current_progress, const uint32_t max_progress);
+
+private:
+	void on_new_connection();
+	void read_events(QLocalSocket *socket);
+	void process_event(const QByteArray &line);
+	bool process_stat_event(const QByteArray &event_type, const QByteArray &argument);
+	void flush_events();
+
+private:
+	QLocalServer *server = nullptr;
+	QTimer *batch_timer = nullptr;
+	int client_count = 0;
+	std::vector<std::string> pending_achievements;
+};
@@ -0,0 +1,144 @@
+#include "game_output_capture.h"
+
+#include "util.h"
+
+#include <QDateTime>
+
+#include <algorithm>
+
+game_output_mode string_to_game_output_mode(const std::string &str)
+{
+	if (str == "capture") {
+		return game_output_mode::capture;
+	} else if (str == "forward") {
+		return game_output_mode::forward;
+	} else if (str == "discard") {
+		return game_output_mode::discard;
+	}
+
+	throw std::runtime_error("Invalid game output mode: \"" + str + "\".");
+}
+
+std::filesystem::path game_output_capture::get_log_filepath()
+{
+	std::filesystem::path filepath = get_logs_path() / "game_output.log";
+	filepath.make_preferred();
+	return filepath;
+}
+
+std::filesystem::path game_output_capture::get_crash_report_filepath()
+{
+	std::filesystem::path filepath = get_logs_path() / "game_crash.log";
+	filepath.make_preferred();
+	return filepath;
+}
+
+game_output_capture::game_output_capture()
+{
+	this->tail_buffer.resize(game_output_capture::tail_size);
+}
+
+void game_output_capture::start_session()
+{
+	this->tail_position = 0;
+	this->tail_full = false;
+
+	this->open_log();
+
+	const std::string header = "[" + QDateTime::currentDateTime().toString(date_string_format).toStdString() + "] Game started.\n";
+	this->log_ofstream << header;
+	this->log_size += header.size();
+}
+
+void game_output_capture::end_session()
+{
+	if (this->log_ofstream.is_open()) {
+		this->log_ofstream.close();
+	}
+}
+
+void game_output_capture::append(const char *data, const size_t size)
+{
+	if (size == 0) {
+		return;
+	}
+
+	if (this->log_ofstream.is_open()) {
+		this->log_ofstream.write(data, static_cast<std::streamsize>(size));
+		this->log_size += size;
+
+		if (this->log_size > game_output_capture::max_log_size) {
+			this->log_ofstream.close();
+			rotate_log_files(game_output_capture::get_log_filepath(), game_output_capture::max_rotated_logs);
+			this->open_log();
+		}
+	}
+
+	//only the last part of the data needs to be kept if it is larger than the tail buffer
+	size_t offset = 0;
+	if (size > this->tail_buffer.size()) {
+		offset = size - this->tail_buffer.size();
+	}
+
+	while (offset < size) {
+		const size_t copy_size = std::min(size - offset, this->tail_buffer.size() - this->tail_position);
+		std::copy_n(data + offset, copy_size, this->tail_buffer.begin() + this->tail_position);
+		offset += copy_size;
+		this->tail_position += copy_size;
+
+		if (this->tail_position == this->tail_buffer.size()) {
+			this->tail_position = 0;
+			this->tail_full = true;
+		}
+	}
+}
+
+std::string game_output_capture::get_tail() const
+{
+	if (!this->tail_full) {
+		return std::string(this->tail_buffer.begin(), this->tail_buffer.begin() + this->tail_position);
+	}
+
+	std::string tail(this->tail_buffer.begin() + this->tail_position, this->tail_buffer.end());
+	tail.append(this->tail_buffer.begin(), this->tail_buffer.begin() + this->tail_position);
+	return tail;
+}
+
+std::filesystem::path game_output_capture::write_crash_report(const std::string &description) const
+{
+	const std::filesystem::path filepath = game_output_capture::get_crash_report_filepath();
+
+	std::ofstream ofstream(filepath, std::ios::binary | std::ios::trunc);
+
+	if (!ofstream) {
+		throw std::runtime_error("Failed to open file \"" + to_string(filepath) + "\" for writing.");
+	}
+
+	ofstream << "[" << QDateTime::currentDateTime().toString(date_string_format).toStdString() << "] " << description << "\n";
+	ofstream << "Last " << game_output_capture::tail_size / 1024 << " KiB of game output:\n";
+	ofstream << this->get_tail();
+
+	return filepath;
+}
+
+void game_output_capture::open_log()
+{
+	const std::filesystem::path filepath = game_output_capture::get_log_filepath();
+
+	std::error_code error_code;
+	this->log_size = std::filesystem::file_size(filepath, error_code);
+	if (error_code) {
+		this->log_size = 0;
+	}
+
+	if (this->log_size > game_output_capture::max_log_size) {
+		rotate_log_files(filepath, game_output_capture::max_rotated_logs);
+		this->log_size = 0;
+	}
+
+	this->log_ofstream.open(filepath, std::ios::binary | std::ios::app);
+
+	if (!this->log_ofstream) {
+		log_error("Failed to open the game output log \"" + to_string(filepath) + "\" for writing.");
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+enum class game_output_mode {
+	capture, //the output is written to a log file, and its end is kept in memory for crash reports
+	forward, //the game writes to the launcher's own output streams
+	discard
+};
+
+game_output_mode string_to_game_output_mode(const std::string &str);
+
+//captures the game's output into size-capped rotating log files, keeping a fixed-size tail of it in memory, so that memory use does not grow with the length of the session
+class game_output_capture final
+{
+public:
+	static constexpr uintmax_t max_log_size = 4 * 1024 * 1024;
+	static constexpr int max_rotated_logs = 2;
+	static constexpr size_t tail_size = 64 * 1024; //the amount of the most recent output kept in memory
+
+	static std::filesystem::path get_log_filepath();
+	static std::filesystem::path get_crash_report_filepath();
+
+	game_output_capture();
+
+	//start capturing the output of a new game session
+	void start_session();
+	void end_session();
+
+	void append(const char *data, const size_t size);
+
+	//get the most recent output
+	std::string get_tail() const;
+
+	//write the most recent output to the crash report file, returning its path
+	std::filesystem::path write_crash_report(const std::string &description) const;
+
+private:
+	void open_log();
+
+private:
+	std::ofstream log_ofstream;
+	uintmax_t log_size = 0;
+	std::vector<char> tail_buffer; //ring buffer with the most recent output
+	size_t tail_position = 0; //the position in the ring buffer at which the next output is written
+	bool tail_full = false;
+};
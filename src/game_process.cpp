@@ -0,0 +1,75 @@
+#include "game_process.h"
+
+#include "launch_profile.h"
+#include "util.h"
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+//the ioprio constants are not provided by glibc
+static constexpr int ioprio_who_process = 1;
+static constexpr int ioprio_class_shift = 13;
+
+static int get_ioprio_class(const io_priority_class io_class)
+{
+	switch (io_class) {
+		case io_priority_class::realtime:
+			return 1;
+		case io_priority_class::best_effort:
+			return 2;
+		case io_priority_class::idle:
+			return 3;
+		default:
+			return 0;
+	}
+}
+#endif
+
+game_process::game_process(const launch_profile &profile, QObject *parent) : QProcess(parent), nice(profile.nice), memory_limit(profile.memory_limit)
+{
+#ifdef __linux__
+	CPU_ZERO(&this->cpu_affinity);
+
+	for (const int cpu : profile.cpu_affinity) {
+		if (cpu < CPU_SETSIZE) {
+			CPU_SET(cpu, &this->cpu_affinity);
+			this->has_cpu_affinity = true;
+		}
+	}
+
+	if (profile.io_class != io_priority_class::none) {
+		this->io_priority = (get_ioprio_class(profile.io_class) << ioprio_class_shift) | profile.io_priority;
+	}
+#else
+	if (!profile.cpu_affinity.empty() || profile.nice != 0 || profile.io_class != io_priority_class::none || profile.memory_limit != 0) {
+		log_error("The scheduling settings of launch profile \"" + profile.name.toStdString() + "\" are not supported on this platform.");
+	}
+#endif
+}
+
+void game_process::setupChildProcess()
+{
+#ifdef __linux__
+	//failures are ignored, as the game should still start if e.g. a higher priority is not permitted
+	if (this->has_cpu_affinity) {
+		sched_setaffinity(0, sizeof(this->cpu_affinity), &this->cpu_affinity);
+	}
+
+	if (this->nice != 0) {
+		setpriority(PRIO_PROCESS, 0, this->nice);
+	}
+
+	if (this->io_priority != -1) {
+		syscall(SYS_ioprio_set, ioprio_who_process, 0, this->io_priority);
+	}
+
+	if (this->memory_limit != 0) {
+		const rlimit limit{ static_cast<rlim_t>(this->memory_limit), static_cast<rlim_t>(this->memory_limit) };
+		setrlimit(RLIMIT_AS, &limit);
+	}
+#endif
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QProcess>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+struct launch_profile;
+
+//process for the game, which applies the scheduling settings of a launch profile in the child process before the game is executed
+class game_process final : public QProcess
+{
+	Q_OBJECT
+
+public:
+	explicit game_process(const launch_profile &profile, QObject *parent = nullptr);
+
+protected:
+	//called in the child process after forking, so only async-signal-safe functions may be used here
+	virtual void setupChildProcess() override;
+
+private:
+#ifdef __linux__
+	bool has_cpu_affinity = false;
+	cpu_set_t cpu_affinity;
+	int io_priority = -1; //the ioprio value to set, or -1 if the I/O priority is not changed
+#endif
+	int nice = 0;
+	unsigned long long memory_limit = 0;
+};
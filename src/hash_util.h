@@ -0,0 +1,131 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+//implementation of the XXH64 non-cryptographic hash function, which processes its input in four independent lanes, allowing for instruction-level parallelism
+namespace xxh64 {
+
+constexpr uint64_t prime_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t prime_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t prime_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t prime_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t prime_5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t read_64(const unsigned char *data)
+{
+	uint64_t value;
+	std::memcpy(&value, data, sizeof(value));
+
+	if constexpr (std::endian::native == std::endian::big) {
+		value = ((value & 0xFF00000000000000ULL) >> 56) | ((value & 0x00FF000000000000ULL) >> 40) | ((value & 0x0000FF0000000000ULL) >> 24) | ((value & 0x000000FF00000000ULL) >> 8) | ((value & 0x00000000FF000000ULL) << 8) | ((value & 0x0000000000FF0000ULL) << 24) | ((value & 0x000000000000FF00ULL) << 40) | ((value & 0x00000000000000FFULL) << 56);
+	}
+
+	return value;
+}
+
+inline uint32_t read_32(const unsigned char *data)
+{
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+
+	if constexpr (std::endian::native == std::endian::big) {
+		value = ((value & 0xFF000000U) >> 24) | ((value & 0x00FF0000U) >> 8) | ((value & 0x0000FF00U) << 8) | ((value & 0x000000FFU) << 24);
+	}
+
+	return value;
+}
+
+inline uint64_t lane_round(uint64_t accumulator, const uint64_t input)
+{
+	accumulator += input * prime_2;
+	accumulator = std::rotl(accumulator, 31);
+	accumulator *= prime_1;
+	return accumulator;
+}
+
+inline uint64_t merge_round(uint64_t accumulator, const uint64_t value)
+{
+	accumulator ^= lane_round(0, value);
+	accumulator = accumulator * prime_1 + prime_4;
+	return accumulator;
+}
+
+}
+
+inline uint64_t hash_data(const void *data, const size_t size, const uint64_t seed = 0)
+{
+	using namespace xxh64;
+
+	const unsigned char *pos = static_cast<const unsigned char *>(data);
+	const unsigned char *const end = pos + size;
+	uint64_t hash = 0;
+
+	if (size >= 32) {
+		const unsigned char *const limit = end - 32;
+		uint64_t v1 = seed + prime_1 + prime_2;
+		uint64_t v2 = seed + prime_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - prime_1;
+
+		do {
+			v1 = lane_round(v1, read_64(pos));
+			v2 = lane_round(v2, read_64(pos + 8));
+			v3 = lane_round(v3, read_64(pos + 16));
+			v4 = lane_round(v4, read_64(pos + 24));
+			pos += 32;
+		} while (pos <= limit);
+
+		hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+		hash = merge_round(hash, v1);
+		hash = merge_round(hash, v2);
+		hash = merge_round(hash, v3);
+		hash = merge_round(hash, v4);
+	} else {
+		hash = seed + prime_5;
+	}
+
+	hash += static_cast<uint64_t>(size);
+
+	while (pos + 8 <= end) {
+		hash ^= lane_round(0, read_64(pos));
+		hash = std::rotl(hash, 27) * prime_1 + prime_4;
+		pos += 8;
+	}
+
+	if (pos + 4 <= end) {
+		hash ^= static_cast<uint64_t>(read_32(pos)) * prime_1;
+		hash = std::rotl(hash, 23) * prime_2 + prime_3;
+		pos += 4;
+	}
+
+	while (pos < end) {
+		hash ^= static_cast<uint64_t>(*pos) * prime_5;
+		hash = std::rotl(hash, 11) * prime_1;
+		++pos;
+	}
+
+	hash ^= hash >> 33;
+	hash *= prime_2;
+	hash ^= hash >> 29;
+	hash *= prime_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+inline uint64_t hash_string(const std::string_view str, const uint64_t seed = 0)
+{
+	return hash_data(str.data(), str.size(), seed);
+}
+
+inline std::string to_hex_string(const uint64_t hash)
+{
+	char str[17];
+	std::snprintf(str, sizeof(str), "%016llx", static_cast<unsigned long long>(hash));
+	return str;
+}
@@ -0,0 +1,304 @@
+#include "headless_runner.h"
+
+#include "achievement_manager.h"
+#include "mod_manager.h"
+#include "mod_upload.h"
+#include "steam_api_backend.h"
+#include "steam_callback_pump.h"
+#include "steam_initializer.h"
+#include "util.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <string_view>
+
+static constexpr std::string_view headless_options[] = { "--upload-mod", "--validate-mod", "--sync-achievements" };
+
+//process events until the condition is fulfilled; returns false if the timeout, if any, expired first
+static bool wait_until(const std::function<bool()> &condition, const int timeout_ms = -1)
+{
+	const QDeadlineTimer deadline = timeout_ms >= 0 ? QDeadlineTimer(timeout_ms) : QDeadlineTimer(QDeadlineTimer::Forever);
+
+	while (!condition()) {
+		if (deadline.hasExpired()) {
+			return false;
+		}
+
+		QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 50);
+	}
+
+	return true;
+}
+
+static std::filesystem::path get_mod_path(const QString &mod_path_str)
+{
+	std::filesystem::path mod_path = to_path(mod_path_str).lexically_normal();
+	if (!mod_path.has_filename()) {
+		mod_path = mod_path.parent_path();
+	}
+
+	return mod_path;
+}
+
+bool headless_runner::is_headless_command_line(const int argc, const char *const *argv)
+{
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view argument = argv[i];
+
+		for (const std::string_view option : headless_options) {
+			//the option's value may be given in the same argument, e.g. "--upload-mod=<dir>"
+			if (argument == option || (argument.starts_with(option) && argument.size() > option.size() && argument[option.size()] == '=')) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+int headless_runner::run(const trace_recorder::clock::time_point start_time)
+{
+	QCommandLineParser cmd_parser;
+	cmd_parser.setApplicationDescription("Runs the launcher's commands without its interface, writing the results to the standard output as JSON.");
+	const QCommandLineOption help_option = cmd_parser.addHelpOption();
+
+	const QCommandLineOption upload_option("upload-mod", "Upload the mod in the given directory to the Steam Workshop; further directories can be given after it.", "dir");
+	cmd_parser.addOption(upload_option);
+
+	const QCommandLineOption validate_option("validate-mod", "Check whether the mod in the given directory can be uploaded; further directories can be given after it.", "dir");
+	cmd_parser.addOption(validate_option);
+
+	const QCommandLineOption sync_option("sync-achievements", "Synchronize the achievements unlocked in the game with Steam.");
+	cmd_parser.addOption(sync_option);
+
+	const QCommandLineOption clear_option("clear-achievements", "Clear achievements when synchronizing them, instead of setting them.");
+	cmd_parser.addOption(clear_option);
+
+	const QCommandLineOption trace_option("trace", "Record a Chrome trace of the launcher's activity to the given file.", "file");
+	cmd_parser.addOption(trace_option);
+
+	cmd_parser.addPositionalArgument("dirs", "Further mod directories for --upload-mod or --validate-mod.", "[dirs...]");
+
+	if (!cmd_parser.parse(QCoreApplication::arguments())) {
+		log_error(cmd_parser.errorText().toStdString());
+		this->output["error"] = cmd_parser.errorText();
+		this->write_output();
+		return static_cast<int>(exit_code::invalid_arguments);
+	}
+
+	if (cmd_parser.isSet(help_option)) {
+		cmd_parser.showHelp();
+	}
+
+	QStringList upload_paths = cmd_parser.values(upload_option);
+	QStringList validate_paths = cmd_parser.values(validate_option);
+	const QStringList positional_arguments = cmd_parser.positionalArguments();
+
+	if (!positional_arguments.isEmpty()) {
+		if (upload_paths.isEmpty() == validate_paths.isEmpty()) {
+			const QString error_message = "Further mod directories can only be given with either --upload-mod or --validate-mod.";
+			log_error(error_message.toStdString());
+			this->output["error"] = error_message;
+			this->write_output();
+			return static_cast<int>(exit_code::invalid_arguments);
+		}
+
+		(upload_paths.isEmpty() ? validate_paths : upload_paths).append(positional_arguments);
+	}
+
+	const bool sync = cmd_parser.isSet(sync_option);
+
+	if (cmd_parser.isSet(trace_option)) {
+		trace_recorder::start(to_path(cmd_parser.value(trace_option)), start_time);
+		trace_recorder::set_thread_name("main");
+	}
+
+	//Steam is only initialized if a command needs it; it is initialized in the background while the mods are validated
+	steam_backend *steam = nullptr;
+	std::unique_ptr<steam_initializer> initializer;
+	std::unique_ptr<steam_callback_pump> callback_pump;
+
+	if (!upload_paths.isEmpty() || sync) {
+		steam_backend::set(std::make_unique<steam_api_backend>());
+		steam = steam_backend::get();
+
+		initializer = std::make_unique<steam_initializer>(steam);
+		callback_pump = std::make_unique<steam_callback_pump>(steam);
+
+		QObject::connect(initializer.get(), &steam_initializer::finished, callback_pump.get(), &steam_callback_pump::start);
+		initializer->start();
+	}
+
+	if (!validate_paths.isEmpty()) {
+		this->validate_mods(validate_paths);
+	}
+
+	if (initializer != nullptr) {
+		wait_until([&initializer]() {
+			return initializer->is_finished();
+		});
+
+		if (!initializer->is_initialized()) {
+			this->set_exit_code(exit_code::steam_unavailable);
+		}
+	}
+
+	if (!upload_paths.isEmpty()) {
+		this->upload_mods(upload_paths);
+	}
+
+	if (sync) {
+		this->sync_achievements(cmd_parser.isSet(clear_option));
+	}
+
+	if (steam != nullptr) {
+		callback_pump->stop();
+		initializer->wait_for_finished();
+		steam->shutdown();
+	}
+
+	this->output["exit_code"] = static_cast<int>(this->result);
+	this->write_output();
+
+	return static_cast<int>(this->result);
+}
+
+void headless_runner::validate_mods(const QStringList &mod_paths)
+{
+	QJsonArray results;
+
+	for (const QString &mod_path_str : mod_paths) {
+		QJsonObject mod_result;
+		mod_result["path"] = mod_path_str;
+
+		try {
+			mod_data mod_data;
+			mod_data.path = get_mod_path(mod_path_str);
+			const mod_validator::result validation_result = mod_manager::validate_mod(mod_data);
+
+			QJsonArray problems;
+			for (const mod_validator::problem &problem : validation_result.problems) {
+				QJsonObject problem_object;
+				problem_object["path"] = QString::fromStdString(problem.relative_path);
+				problem_object["message"] = QString::fromStdString(problem.message);
+				problems.append(problem_object);
+			}
+
+			const bool valid = validation_result.problems.empty();
+
+			mod_result["valid"] = valid;
+			mod_result["problems"] = problems;
+			mod_result["name"] = QString::fromStdString(mod_data.name);
+			mod_result["published_file_id"] = QString::number(mod_data.published_file_id);
+			mod_result["file_count"] = static_cast<qint64>(validation_result.file_count);
+			mod_result["total_size"] = static_cast<qint64>(validation_result.total_size);
+
+			if (valid) {
+				//hash the files, so that it can be reported whether the mod has changed since it was last published
+				mod_manager::update_manifest(mod_data);
+				mod_result["content_hash"] = QString::number(mod_data.manifest.get_content_hash(), 16);
+				mod_result["content_published"] = mod_data.manifest.is_content_published(mod_data.published_file_id);
+			} else {
+				this->set_exit_code(exit_code::failure);
+			}
+		} catch (const std::exception &exception) {
+			report_exception(exception);
+			mod_result["valid"] = false;
+			mod_result["error"] = QString::fromStdString(exception.what());
+			this->set_exit_code(exit_code::failure);
+		}
+
+		results.append(mod_result);
+	}
+
+	this->output["validated_mods"] = results;
+}
+
+void headless_runner::upload_mods(const QStringList &mod_paths)
+{
+	mod_manager mod_manager;
+	std::vector<mod_upload *> uploads;
+
+	for (const QString &mod_path_str : mod_paths) {
+		uploads.push_back(mod_manager.upload_mod(QUrl::fromLocalFile(to_qstring(get_mod_path(mod_path_str)))));
+	}
+
+	//uploads have no timeout, since large mods can take a long time to upload
+	wait_until([&uploads]() {
+		return std::all_of(uploads.begin(), uploads.end(), [](const mod_upload *upload) {
+			return upload->is_finished();
+		});
+	});
+
+	QJsonArray results;
+
+	for (size_t i = 0; i < uploads.size(); ++i) {
+		const mod_upload *upload = uploads[i];
+		const bool success = upload->get_state() == mod_upload::upload_state::done;
+
+		QJsonObject upload_result;
+		upload_result["path"] = mod_paths[static_cast<int>(i)];
+		upload_result["success"] = success;
+		upload_result["published_file_id"] = QString::number(upload->get_mod_data()->published_file_id);
+
+		if (!success) {
+			upload_result["error"] = upload->get_error_message();
+			this->set_exit_code(exit_code::failure);
+		}
+
+		results.append(upload_result);
+	}
+
+	this->output["uploaded_mods"] = results;
+}
+
+void headless_runner::sync_achievements(const bool clear)
+{
+	steam_backend *steam = steam_backend::get();
+
+	if (steam->is_user_stats_available()) {
+		wait_until([steam]() {
+			return steam->is_user_stats_received();
+		}, headless_runner::user_stats_timeout_ms);
+	}
+
+	//if Steam is unavailable, the changes are recorded in the journal, to be made in a later session
+	achievement_manager achievement_manager(clear);
+	achievement_manager.check_achievements();
+	achievement_manager.flush_stats();
+
+	//wait for the stores to be confirmed, since Steam may not send them if the process exits first
+	const bool stored = wait_until([steam]() {
+		return steam->get_pending_call_count() == 0;
+	}, headless_runner::store_timeout_ms);
+
+	//the journal only covers achievements, so stats whose store failed are only kept in memory, waiting for a later flush which is not made here
+	const bool synchronized = steam->is_user_stats_received() && achievement_manager.get_journaled_change_count() == 0 && stored && achievement_manager.get_unstored_stat_count() == 0 && achievement_manager.get_failed_store_count() == 0;
+
+	QJsonObject sync_result;
+	sync_result["synchronized"] = synchronized;
+	sync_result["journaled_changes"] = static_cast<qint64>(achievement_manager.get_journaled_change_count());
+	sync_result["stat_updates"] = static_cast<qint64>(achievement_manager.get_flushed_stat_update_count());
+	sync_result["stores"] = static_cast<qint64>(achievement_manager.get_store_count());
+	sync_result["failed_stores"] = static_cast<qint64>(achievement_manager.get_failed_store_count());
+	sync_result["unstored_stats"] = static_cast<qint64>(achievement_manager.get_unstored_stat_count());
+	this->output["achievements"] = sync_result;
+
+	if (!synchronized) {
+		this->set_exit_code(exit_code::steam_unavailable);
+	}
+}
+
+void headless_runner::write_output() const
+{
+	const QByteArray json = QJsonDocument(this->output).toJson(QJsonDocument::Indented);
+	std::fwrite(json.constData(), 1, static_cast<size_t>(json.size()), stdout);
+	std::fflush(stdout);
+}
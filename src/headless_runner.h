@@ -0,0 +1,45 @@
+#pragma once
+
+#include "trace.h"
+
+#include <QJsonObject>
+#include <QStringList>
+
+//runs the launcher's commands without its interface, e.g. to publish mods from build machines without a display server
+//the results are written to the standard output as JSON, and summarized by the exit code
+class headless_runner final
+{
+public:
+	enum class exit_code {
+		success = 0,
+		failure = 1, //a mod could not be validated or uploaded
+		invalid_arguments = 2,
+		steam_unavailable = 3 //Steam could not be used, e.g. because its client is not running
+	};
+
+	static constexpr int user_stats_timeout_ms = 10000; //the maximum time to wait for the user's stats to be received from Steam
+	static constexpr int store_timeout_ms = 10000; //the maximum time to wait for Steam to confirm that the achievement changes have been stored
+
+	//get whether the command line contains a headless command, which is checked before the application is created, so that the interface is not initialized for it
+	static bool is_headless_command_line(const int argc, const char *const *argv);
+
+	int run(const trace_recorder::clock::time_point start_time);
+
+private:
+	void validate_mods(const QStringList &mod_paths);
+	void upload_mods(const QStringList &mod_paths);
+	void sync_achievements(const bool clear);
+
+	void set_exit_code(const exit_code code)
+	{
+		if (static_cast<int>(code) > static_cast<int>(this->result)) {
+			this->result = code;
+		}
+	}
+
+	void write_output() const;
+
+private:
+	QJsonObject output;
+	exit_code result = exit_code::success;
+};
@@ -0,0 +1,121 @@
+#include "launch_profile.h"
+
+#include "util.h"
+
+#include <QSettings>
+
+#include <algorithm>
+
+std::filesystem::path launch_profile::get_profiles_filepath()
+{
+	std::filesystem::path filepath = get_user_data_path() / "launch_profiles.ini";
+	filepath.make_preferred();
+	return filepath;
+}
+
+QStringList launch_profile::get_profile_names()
+{
+	const QSettings settings(to_qstring(launch_profile::get_profiles_filepath()), QSettings::IniFormat);
+
+	QStringList profile_names = settings.childGroups();
+
+	if (!profile_names.contains(launch_profile::default_profile_name)) {
+		profile_names.prepend(launch_profile::default_profile_name);
+	}
+
+	return profile_names;
+}
+
+launch_profile launch_profile::load(const QString &name)
+{
+	launch_profile profile;
+	profile.name = name;
+
+	QSettings settings(to_qstring(launch_profile::get_profiles_filepath()), QSettings::IniFormat);
+
+	if (!settings.childGroups().contains(name)) {
+		if (name == launch_profile::default_profile_name) {
+			return profile;
+		}
+
+		throw std::runtime_error("No launch profile named \"" + name.toStdString() + "\" exists.");
+	}
+
+	settings.beginGroup(name);
+
+	for (const QString &key : settings.childKeys()) {
+		const QVariant value = settings.value(key);
+
+		if (key == "arguments") {
+			profile.arguments = value.toStringList();
+		} else if (key == "environment") {
+			for (const QString &variable_str : value.toStringList()) {
+				const int separator_pos = variable_str.indexOf('=');
+
+				if (separator_pos <= 0) {
+					throw std::runtime_error("Invalid environment variable \"" + variable_str.toStdString() + "\" in launch profile \"" + name.toStdString() + "\".");
+				}
+
+				profile.environment.emplace_back(variable_str.left(separator_pos), variable_str.mid(separator_pos + 1));
+			}
+		} else if (key == "cpu_affinity") {
+			profile.cpu_affinity = launch_profile::parse_cpu_list(value.toStringList().join(','));
+		} else if (key == "nice") {
+			profile.nice = std::clamp(value.toInt(), -20, 19);
+		} else if (key == "io_class") {
+			const QString io_class_str = value.toString();
+
+			if (io_class_str == "realtime") {
+				profile.io_class = io_priority_class::realtime;
+			} else if (io_class_str == "best-effort") {
+				profile.io_class = io_priority_class::best_effort;
+			} else if (io_class_str == "idle") {
+				profile.io_class = io_priority_class::idle;
+			} else {
+				throw std::runtime_error("Invalid I/O class \"" + io_class_str.toStdString() + "\" in launch profile \"" + name.toStdString() + "\".");
+			}
+		} else if (key == "io_priority") {
+			profile.io_priority = std::clamp(value.toInt(), 0, 7);
+		} else if (key == "memory_limit_mb") {
+			profile.memory_limit = value.toULongLong() * 1024 * 1024;
+		} else {
+			log_error("Invalid key \"" + key.toStdString() + "\" in launch profile \"" + name.toStdString() + "\".");
+		}
+	}
+
+	return profile;
+}
+
+std::vector<int> launch_profile::parse_cpu_list(const QString &cpu_list_str)
+{
+	std::vector<int> cpus;
+
+	for (const QString &range_str : cpu_list_str.split(',')) {
+		//empty entries are skipped, including ones with only whitespace
+		const QString trimmed_range_str = range_str.trimmed();
+		if (trimmed_range_str.isEmpty()) {
+			continue;
+		}
+
+		const QStringList range_parts = trimmed_range_str.split('-');
+		bool ok_first = false;
+		bool ok_last = false;
+
+		const int first_cpu = range_parts.front().toInt(&ok_first);
+		const int last_cpu = range_parts.size() == 2 ? range_parts.back().toInt(&ok_last) : first_cpu;
+
+		if (range_parts.size() == 1) {
+			ok_last = ok_first;
+		}
+
+		if (!ok_first || !ok_last || range_parts.size() > 2 || first_cpu < 0 || last_cpu < first_cpu) {
+			throw std::runtime_error("Invalid CPU list: \"" + cpu_list_str.toStdString() + "\".");
+		}
+
+		for (int cpu = first_cpu; cpu <= last_cpu; ++cpu) {
+			cpus.push_back(cpu);
+		}
+	}
+
+	return cpus;
+}
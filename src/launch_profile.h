@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+//the I/O scheduling class for the game process
+enum class io_priority_class {
+	none, //the game's I/O priority is left unchanged
+	realtime,
+	best_effort,
+	idle
+};
+
+//a named set of settings for launching the game, read from the launch profiles file in the user data directory, e.g.:
+//[streaming]
+//arguments=-w
+//environment=MESA_GLTHREAD=true
+//cpu_affinity=2-7
+//nice=5
+//io_class=best-effort
+//io_priority=4
+//memory_limit_mb=4096
+struct launch_profile final
+{
+	static constexpr const char *default_profile_name = "default";
+
+	static std::filesystem::path get_profiles_filepath();
+
+	//get the names of the profiles in the launch profiles file
+	static QStringList get_profile_names();
+
+	//load a profile from the launch profiles file; the default profile need not be defined in it
+	static launch_profile load(const QString &name);
+
+	//parse a CPU list such as "0-3,6" into the indices of the CPUs
+	static std::vector<int> parse_cpu_list(const QString &cpu_list_str);
+
+	QString name;
+	QStringList arguments;
+	std::vector<std::pair<QString, QString>> environment;
+	std::vector<int> cpu_affinity; //the CPUs the game may run on; empty if it is not restricted
+	int nice = 0;
+	io_priority_class io_class = io_priority_class::none;
+	int io_priority = 4; //the priority within the I/O class, from 0 (highest) to 7 (lowest)
+	uint64_t memory_limit = 0; //the maximum address space of the game process in bytes, or 0 if it is not limited
+};
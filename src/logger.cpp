@@ -0,0 +1,284 @@
+#include "logger.h"
+
+#include "util.h"
+
+#include <QDateTime>
+
+#include <cstdio>
+
+#ifdef USE_WIN32
+static constexpr const char *null_device_path = "NUL";
+#else
+static constexpr const char *null_device_path = "/dev/null";
+#endif
+
+static bool is_error_level(const log_level level)
+{
+	return level >= log_level::warning;
+}
+
+static std::FILE *get_output_stream(const log_level level)
+{
+	return is_error_level(level) || logger::is_standard_output_reserved() ? stderr : stdout;
+}
+
+static void write_synchronously(const log_level level, const std::string_view &message)
+{
+	std::FILE *stream = get_output_stream(level);
+	const std::string line = "[" + QDateTime::currentDateTime().toString(date_string_format).toStdString() + "] " + std::string(message) + "\n";
+	std::fwrite(line.data(), 1, line.size(), stream);
+
+	if (stream == stderr) {
+		std::fflush(stream);
+	}
+}
+
+static bool open_error_log(const std::filesystem::path &filepath)
+{
+	const std::string path_str = to_string(filepath);
+	return freopen(path_str.c_str(), "a", stderr) != nullptr;
+}
+
+void logger::start(const std::filesystem::path &error_log_filepath)
+{
+	if (logger::running_instance.load() != nullptr) {
+		return;
+	}
+
+	std::error_code error_code;
+	if (std::filesystem::file_size(error_log_filepath, error_code) > logger::max_error_log_size && !error_code) {
+		rotate_log_files(error_log_filepath, logger::max_rotated_error_logs);
+	}
+
+	if (!open_error_log(error_log_filepath)) {
+		logger::write(log_level::error, "Failed to create error log.");
+	}
+
+	logger::instance = std::unique_ptr<logger>(new logger(error_log_filepath));
+	logger::instance->writer_thread = std::thread(&logger::run, logger::instance.get());
+	logger::running_instance.store(logger::instance.get());
+}
+
+void logger::stop()
+{
+	logger *running_logger = logger::running_instance.exchange(nullptr);
+
+	if (running_logger == nullptr) {
+		return;
+	}
+
+	//the writer thread writes the remaining messages before finishing; the logger itself is kept, since other threads may still be pushing messages to it
+	running_logger->stopping.store(true);
+	running_logger->wake_writer();
+	running_logger->writer_thread.join();
+
+	const uint64_t dropped_message_count = running_logger->dropped_message_count.load();
+	if (dropped_message_count > 0) {
+		logger::write(log_level::warning, std::to_string(dropped_message_count) + " log messages were dropped because the log queue was full.");
+	}
+}
+
+void logger::write(const log_level level, const std::string_view &message)
+{
+	logger *running_logger = logger::running_instance.load();
+
+	if (running_logger == nullptr) {
+		write_synchronously(level, message);
+		return;
+	}
+
+	if (!running_logger->try_push(level, std::time(nullptr), message)) {
+		if (level < log_level::error) {
+			running_logger->dropped_message_count.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		//errors are not dropped, since they are needed the most when logging is under pressure, e.g. right before an abort; the messages already queued are written first, so that the order is kept
+		logger::flush();
+
+		if (!running_logger->try_push(level, std::time(nullptr), message)) {
+			write_synchronously(level, message);
+			return;
+		}
+	}
+
+	running_logger->wake_writer();
+
+	if (level == log_level::fatal) {
+		//the application is about to abort, so the message needs to have been written before returning
+		logger::flush();
+	}
+}
+
+void logger::flush()
+{
+	logger *running_logger = logger::running_instance.load();
+
+	if (running_logger == nullptr) {
+		std::fflush(stdout);
+		std::fflush(stderr);
+		return;
+	}
+
+	if (std::this_thread::get_id() == running_logger->writer_thread.get_id()) {
+		return;
+	}
+
+	const size_t target_position = running_logger->enqueue_position.load();
+	running_logger->wake_writer();
+
+	size_t position = running_logger->written_position.load();
+	while (position < target_position) {
+		running_logger->written_position.wait(position);
+		position = running_logger->written_position.load();
+	}
+}
+
+uint64_t logger::get_dropped_message_count()
+{
+	const logger *running_logger = logger::running_instance.load();
+
+	if (running_logger == nullptr) {
+		return 0;
+	}
+
+	return running_logger->dropped_message_count.load(std::memory_order_relaxed);
+}
+
+logger::logger(const std::filesystem::path &error_log_filepath) : error_log_filepath(error_log_filepath)
+{
+	this->cells = std::make_unique<queue_cell[]>(logger::queue_capacity);
+
+	for (size_t i = 0; i < logger::queue_capacity; ++i) {
+		this->cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	std::error_code error_code;
+	this->error_log_size = std::filesystem::file_size(error_log_filepath, error_code);
+	if (error_code) {
+		this->error_log_size = 0;
+	}
+}
+
+bool logger::try_push(const log_level level, const std::time_t time, const std::string_view &message)
+{
+	//bounded multi-producer queue, where each cell's sequence number tells whether it is free to be written to for a given position, or has a message for it
+	size_t position = this->enqueue_position.load(std::memory_order_relaxed);
+	queue_cell *cell = nullptr;
+
+	while (true) {
+		cell = &this->cells[position & (logger::queue_capacity - 1)];
+		const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+		if (difference == 0) {
+			if (this->enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (difference < 0) {
+			//the queue is full
+			return false;
+		} else {
+			position = this->enqueue_position.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->level = level;
+	cell->time = time;
+	cell->message = message;
+
+	//sequentially consistent, so that the writer cannot miss the message when it is about to wait
+	cell->sequence.store(position + 1);
+
+	return true;
+}
+
+bool logger::is_message_available() const
+{
+	const queue_cell &cell = this->cells[this->dequeue_position & (logger::queue_capacity - 1)];
+	return cell.sequence.load() == this->dequeue_position + 1;
+}
+
+void logger::run()
+{
+	while (true) {
+		bool wrote_messages = false;
+
+		while (this->is_message_available()) {
+			queue_cell &cell = this->cells[this->dequeue_position & (logger::queue_capacity - 1)];
+			const std::string message = std::move(cell.message);
+			const log_level level = cell.level;
+			const std::time_t time = cell.time;
+
+			//free the cell for the position it will be used for next
+			cell.sequence.store(this->dequeue_position + logger::queue_capacity, std::memory_order_release);
+			++this->dequeue_position;
+
+			this->write_message(level, time, message);
+			wrote_messages = true;
+		}
+
+		if (wrote_messages) {
+			std::fflush(stdout);
+			std::fflush(stderr);
+
+			if (this->error_log_size > logger::max_error_log_size) {
+				//the error log cannot be renamed while it is open on Windows
+				if (freopen(null_device_path, "a", stderr) != nullptr) {
+					rotate_log_files(this->error_log_filepath, logger::max_rotated_error_logs);
+				}
+
+				open_error_log(this->error_log_filepath);
+				this->error_log_size = 0;
+			}
+
+			this->written_position.store(this->dequeue_position);
+			this->written_position.notify_all();
+			continue;
+		}
+
+		if (this->stopping.load()) {
+			break;
+		}
+
+		this->writer_waiting.store(true);
+
+		if (this->is_message_available() || this->stopping.load()) {
+			this->writer_waiting.store(false);
+			continue;
+		}
+
+		this->writer_waiting.wait(true);
+	}
+}
+
+void logger::wake_writer()
+{
+	if (this->writer_waiting.load() && this->writer_waiting.exchange(false)) {
+		this->writer_waiting.notify_one();
+	}
+}
+
+void logger::write_message(const log_level level, const std::time_t time, const std::string &message)
+{
+	const std::string &timestamp_prefix = this->get_timestamp_prefix(time);
+
+	std::FILE *stream = get_output_stream(level);
+	std::fwrite(timestamp_prefix.data(), 1, timestamp_prefix.size(), stream);
+	std::fwrite(message.data(), 1, message.size(), stream);
+	std::fputc('\n', stream);
+
+	if (stream == stderr) {
+		this->error_log_size += timestamp_prefix.size() + message.size() + 1;
+	}
+}
+
+const std::string &logger::get_timestamp_prefix(const std::time_t time)
+{
+	if (time != this->cached_timestamp_time) {
+		this->cached_timestamp_time = time;
+		this->cached_timestamp_prefix = "[" + QDateTime::fromSecsSinceEpoch(time).toString(date_string_format).toStdString() + "] ";
+	}
+
+	return this->cached_timestamp_prefix;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+enum class log_level {
+	debug,
+	info,
+	warning,
+	error,
+	fatal
+};
+
+//asynchronous logger; messages are put in a bounded lock-free queue, and written by a background thread, so that logging never has to wait for disk writes
+//debug and info messages are written to the standard output, and the others to the standard error, which is redirected to the error log, which is rotated when it becomes too large
+//before the logger has been started, or after it has been stopped, messages are written synchronously, as are error messages which do not fit in a full queue
+class logger final
+{
+public:
+	static constexpr size_t queue_capacity = 8192; //must be a power of two
+	static constexpr uintmax_t max_error_log_size = 1000000;
+	static constexpr int max_rotated_error_logs = 2; //the number of previous error logs which are kept, e.g. "launcher_error.log.1" and "launcher_error.log.2"
+
+	static void start(const std::filesystem::path &error_log_filepath);
+	static void stop();
+
+	static void write(const log_level level, const std::string_view &message);
+
+	//wait until the messages logged so far have been written
+	static void flush();
+
+	//get the number of debug, info and warning messages which were dropped because the queue was full
+	static uint64_t get_dropped_message_count();
+
+	static bool is_standard_output_reserved()
+	{
+		return logger::standard_output_reserved.load(std::memory_order_relaxed);
+	}
+
+	//reserve the standard output for other uses, e.g. for the results of headless commands, so that all messages are written to the standard error instead
+	static void set_standard_output_reserved(const bool reserved)
+	{
+		logger::standard_output_reserved.store(reserved, std::memory_order_relaxed);
+	}
+
+private:
+	static inline std::unique_ptr<logger> instance;
+	static inline std::atomic<logger *> running_instance = nullptr;
+	static inline std::atomic<bool> standard_output_reserved = false;
+
+	struct queue_cell final
+	{
+		std::atomic<size_t> sequence = 0;
+		log_level level = log_level::info;
+		std::time_t time = 0;
+		std::string message;
+	};
+
+	explicit logger(const std::filesystem::path &error_log_filepath);
+
+	bool try_push(const log_level level, const std::time_t time, const std::string_view &message);
+	bool is_message_available() const;
+	void run();
+	void wake_writer();
+	void write_message(const log_level level, const std::time_t time, const std::string &message);
+	const std::string &get_timestamp_prefix(const std::time_t time);
+
+private:
+	std::filesystem::path error_log_filepath;
+	std::unique_ptr<queue_cell[]> cells;
+	std::atomic<size_t> enqueue_position = 0;
+	size_t dequeue_position = 0; //only used by the writer thread
+	std::atomic<size_t> written_position = 0; //the position up to which messages have been written and flushed
+	std::atomic<bool> writer_waiting = false;
+	std::atomic<bool> stopping = false;
+	std::atomic<uint64_t> dropped_message_count = 0;
+	uintmax_t error_log_size = 0;
+	std::time_t cached_timestamp_time = -1; //the timestamp prefix is cached per second, since it is the same for all messages logged within it
+	std::string cached_timestamp_prefix;
+	std::thread writer_thread;
+};
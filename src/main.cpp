@@ -1,38 +1,67 @@
+#include "asset_prefetcher.h"
+#include "game_output_capture.h"
+#include "headless_runner.h"
+#include "launch_profile.h"
+#include "mod_index.h"
 #include "mod_manager.h"
 #include "process_manager.h"
+#include "process_monitor.h"
+#include "steam_api_backend.h"
+#include "steam_callback_pump.h"
+#include "steam_initializer.h"
+#include "trace.h"
 #include "util.h"
-
-#include "steam/isteamuserstats.h"
-#include "steam/steam_api.h"
+#include "workshop_subscription_manager.h"
 
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QDir>
+#include <QFutureWatcher>
 #include <QIcon>
 #include <QQmlApplicationEngine>
+#include <QQmlComponent>
 #include <QQmlContext>
-#include <QTimer>
+#include <QtConcurrent>
 
 #include <filesystem>
 
 static void init_output()
 {
-	const std::filesystem::path error_log_path = get_error_log_filepath();
+	//the error log is rotated by the logger when it becomes too large
+	logger::start(get_error_log_filepath());
+}
 
-	if (std::filesystem::exists(error_log_path) && std::filesystem::file_size(error_log_path) > 1000000) {
-		std::filesystem::remove(error_log_path);
-	}
+struct startup_images final
+{
+	QImage icon;
+	QImage cursor;
+};
 
-	const std::string path_str = to_string(error_log_path);
+static startup_images load_startup_images(const QString &root_path_qstr, const int scale_factor)
+{
+	startup_images images;
+	images.icon = QImage(root_path_qstr + "/graphics/interface/icons/wyrmsun_icon_128_background.png");
+	images.cursor = QImage(root_path_qstr + "/graphics/cursors/dwarven/dwarven_gauntlet" + (scale_factor > 1 ? QString::fromStdString("_" + std::to_string(scale_factor) + "x") : "") + ".png");
+	return images;
+}
 
-	const FILE *error_log_file = freopen(path_str.c_str(), "a", stderr);
-	if (error_log_file == nullptr) {
-		log_error("Failed to create error log.");
-	}
+static void apply_startup_images(const startup_images &images, const int scale_factor)
+{
+	//pixmaps can only be created on the GUI thread
+	QApplication::setWindowIcon(QIcon(QPixmap::fromImage(images.icon)));
+
+	//set cursor
+	const QPixmap pixmap = QPixmap::fromImage(images.cursor);
+	const QPoint hot_pos(3 * scale_factor, 1 * scale_factor);
+	const QCursor qcursor(pixmap, hot_pos.x(), hot_pos.y());
+
+	QApplication::setOverrideCursor(qcursor);
 }
 
 static void clean_output()
 {
+	logger::stop();
+
 	std::cerr.clear();
 	fclose(stderr);
 
@@ -43,14 +72,60 @@ static void clean_output()
 	}
 }
 
-int main(int argc, char **argv)
+static void stop_trace()
 {
-	qInstallMessageHandler(log_qt_message);
+	try {
+		trace_recorder::stop();
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+	}
+}
 
-	QApplication app(argc, argv);
+static void set_application_info(QCoreApplication &app)
+{
 	app.setApplicationName("Wyrmsun");
 	app.setOrganizationName("Wyrmsun");
 	app.setOrganizationDomain("andrettin.github.io");
+}
+
+static int run_headless(int argc, char **argv, const trace_recorder::clock::time_point main_start_time)
+{
+	//no GUI is initialized for headless commands, so that they can run without a display server
+	QCoreApplication app(argc, argv);
+	set_application_info(app);
+
+	//the standard output is used for the results
+	logger::set_standard_output_reserved(true);
+	init_output();
+
+	int result = 0;
+
+	try {
+		headless_runner runner;
+		result = runner.run(main_start_time);
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+		result = static_cast<int>(headless_runner::exit_code::failure);
+	}
+
+	stop_trace();
+	clean_output();
+
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	const trace_recorder::clock::time_point main_start_time = trace_recorder::clock::now();
+
+	qInstallMessageHandler(log_qt_message);
+
+	if (headless_runner::is_headless_command_line(argc, argv)) {
+		return run_headless(argc, argv, main_start_time);
+	}
+
+	QApplication app(argc, argv);
+	set_application_info(app);
 
 	init_output();
 
@@ -61,6 +136,28 @@ int main(int argc, char **argv)
 
 		const QCommandLineOption clear_option("clear-achievements", "Clear achievements, instead of setting them.");
 		cmd_parser.addOption(clear_option);
+
+		const QCommandLineOption game_output_option("game-output", "What to do with the game's output: \"capture\" it into a log file, \"forward\" it to the launcher's output, or \"discard\" it.", "mode", "capture");
+		cmd_parser.addOption(game_output_option);
+
+		const QCommandLineOption monitor_interval_option("monitor-interval", "The interval at which the resource use of the game is sampled, in milliseconds, with 0 disabling it.", "ms", QString::number(process_monitor::default_sample_interval_ms));
+		cmd_parser.addOption(monitor_interval_option);
+
+		const QCommandLineOption resident_option("resident", "Keep the launcher running after the game exits, so that the game can be relaunched without initializing Steam again.");
+		cmd_parser.addOption(resident_option);
+
+		const QCommandLineOption auto_restart_option("auto-restart", "Restart the game automatically if it exits abnormally; implies --resident.");
+		cmd_parser.addOption(auto_restart_option);
+
+		const QCommandLineOption prefetch_option("prefetch", "How to prefetch the game's files when it is started: \"off\", \"directories\" to prefetch its data directories, or \"recorded\" to also prefetch the files it read in the previous session first.", "mode", "recorded");
+		cmd_parser.addOption(prefetch_option);
+
+		const QCommandLineOption profile_option("profile", "The launch profile to start the game with, from the launch_profiles.ini file in the user data directory.", "name", launch_profile::default_profile_name);
+		cmd_parser.addOption(profile_option);
+
+		const QCommandLineOption trace_option("trace", "Record a Chrome trace of the launcher's activity to the given file.", "file");
+		cmd_parser.addOption(trace_option);
+
 		cmd_parser.process(*QApplication::instance());
 
 		bool clear_achievements = false;
@@ -68,73 +165,134 @@ int main(int argc, char **argv)
 			clear_achievements = true;
 		}
 
+		const game_output_mode output_mode = string_to_game_output_mode(cmd_parser.value(game_output_option).toStdString());
+		const prefetch_mode file_prefetch_mode = string_to_prefetch_mode(cmd_parser.value(prefetch_option).toStdString());
+
+		if (cmd_parser.isSet(trace_option)) {
+			trace_recorder::start(to_path(cmd_parser.value(trace_option)), main_start_time);
+			trace_recorder::set_thread_name("main");
+			trace_recorder::add_complete_event("create_application", "startup", main_start_time, trace_recorder::clock::now());
+		}
+
+		trace_span startup_span("startup", "startup");
+
 		const std::filesystem::path root_path = std::filesystem::current_path();
 		const QString root_path_qstr = QString::fromUtf8(reinterpret_cast<const char *>(root_path.u8string().c_str()));
 
-		app.setWindowIcon(QIcon(root_path_qstr + "/graphics/interface/icons/wyrmsun_icon_128_background.png"));
+		//the Steam API is initialized on a worker thread, since it can take a while for the Steam client to respond; the window can be used in the meantime
+		steam_backend::set(std::make_unique<steam_api_backend>());
+		steam_backend *steam = steam_backend::get();
 
-		//set cursor
-		const int scale_factor = 2;
-		const QPixmap pixmap = QPixmap::fromImage(QImage(root_path_qstr + "/graphics/cursors/dwarven/dwarven_gauntlet" + (scale_factor > 1 ? QString::fromStdString("_" + std::to_string(scale_factor) + "x") : "") + ".png"));
-		const QPoint hot_pos(3 * scale_factor, 1 * scale_factor);
-		const QCursor qcursor(pixmap, hot_pos.x(), hot_pos.y());
+		steam_initializer initializer(steam);
+		steam_callback_pump callback_pump(steam);
 
-		QApplication::setOverrideCursor(qcursor);
+		QObject::connect(&initializer, &steam_initializer::finished, &callback_pump, &steam_callback_pump::start);
+		initializer.start();
 
-		const bool initialized_steam = SteamAPI_Init();
-
-		if (!initialized_steam) {
-			log_error("Failed to initialize the Steam API.");
-		}
+		//decode the images on a worker thread, and apply them once they are ready
+		const int scale_factor = 2;
+		QFutureWatcher<startup_images> images_watcher;
+		QObject::connect(&images_watcher, &QFutureWatcher<startup_images>::finished, [&images_watcher, scale_factor]() {
+			trace_span span("apply_images", "startup");
+			apply_startup_images(images_watcher.result(), scale_factor);
+		});
+		images_watcher.setFuture(QtConcurrent::run([root_path_qstr, scale_factor]() {
+			trace_span span("decode_images", "startup");
+			return load_startup_images(root_path_qstr, scale_factor);
+		}));
 
-		ISteamUserStats *user_stats = SteamUserStats();
-		if (user_stats != nullptr) {
-			user_stats->RequestCurrentStats();
-		} else {
-			log_error("No Steam user information provided.");
-		}
+		trace_span managers_span("create_managers", "startup");
 
 		QQmlApplicationEngine engine;
 
-		process_manager *process_manager = new ::process_manager(clear_achievements);
+		process_manager *process_manager = new ::process_manager(clear_achievements, output_mode, file_prefetch_mode);
+		process_manager->get_monitor()->set_sample_interval_ms(cmd_parser.value(monitor_interval_option).toInt());
+		process_manager->set_resident(cmd_parser.isSet(resident_option) || cmd_parser.isSet(auto_restart_option));
+		process_manager->set_auto_restart_enabled(cmd_parser.isSet(auto_restart_option));
+		process_manager->set_launch_profile_name(cmd_parser.value(profile_option));
 		engine.rootContext()->setContextProperty("process_manager", process_manager);
 
 		mod_manager *mod_manager = new ::mod_manager;
 		engine.rootContext()->setContextProperty("mod_manager", mod_manager);
 
+		mod_index *mod_index = new ::mod_index;
+		engine.rootContext()->setContextProperty("mod_index", mod_index);
+
+		//an upload updates the mod's ID and manifest, which are not noticed by watching the mods directory
+		QObject::connect(mod_manager, &::mod_manager::modUploadCompleted, mod_index, &::mod_index::refresh);
+
+		//start downloading outdated mods as soon as Steam has been initialized, while the player is still in the launcher window
+		workshop_subscription_manager *subscription_manager = new ::workshop_subscription_manager;
+		process_manager->set_subscription_manager(subscription_manager);
+		engine.rootContext()->setContextProperty("workshop_subscription_manager", subscription_manager);
+		subscription_manager->sync();
+
+		managers_span.end();
+
 		engine.addImportPath(root_path_qstr + "/libraries/qml");
 
 		QUrl url = QDir(root_path_qstr + "/interface/").absoluteFilePath("Launcher.qml");
 		url.setScheme("file");
-		QObject::connect(&engine, &QQmlApplicationEngine::objectCreated, &app,
-			[url](QObject *obj, const QUrl &objUrl) {
-				if (!obj && url == objUrl) {
-					QCoreApplication::exit(-1);
+
+		//compile the interface on the engine's loader thread, using the QML disk cache, and create it once it is ready
+		std::unique_ptr<QObject> root_object;
+		QQmlComponent component(&engine);
+		bool component_processed = false;
+		const trace_recorder::clock::time_point component_load_start_time = trace_recorder::clock::now();
+
+		const auto on_component_status_changed = [&component, &root_object, &component_processed, component_load_start_time]() {
+			if (component_processed || component.isLoading() || component.isNull()) {
+				return;
+			}
+
+			component_processed = true;
+			trace_recorder::add_async_event("load_interface", "startup", trace_recorder::generate_async_id(), component_load_start_time, trace_recorder::clock::now());
+
+			if (component.isReady()) {
+				trace_span span("create_interface", "startup");
+				root_object.reset(component.create());
+			}
+
+			if (root_object == nullptr) {
+				for (const QQmlError &error : component.errors()) {
+					log_error(error.toString().toStdString());
 				}
-			}, Qt::QueuedConnection);
-		engine.load(url);
-
-		//run the Steam API callbacks intermittently
-		QTimer run_callbacks_timer;
-		run_callbacks_timer.setInterval(100);
-		QObject::connect(&run_callbacks_timer, &QTimer::timeout, []() {
-			SteamAPI_RunCallbacks();
-		});
-		run_callbacks_timer.start();
+
+				//exit via the event loop, since this may be called before it has started
+				QMetaObject::invokeMethod(QCoreApplication::instance(), [] { QCoreApplication::exit(-1); }, Qt::QueuedConnection);
+			}
+		};
+
+		QObject::connect(&component, &QQmlComponent::statusChanged, on_component_status_changed);
+		component.loadUrl(url, QQmlComponent::Asynchronous);
+
+		//the component may already be complete if it was loaded from the type cache
+		on_component_status_changed();
+
+		startup_span.end();
 
 		result = app.exec();
 
+		root_object.reset();
+		images_watcher.waitForFinished();
+
+		callback_pump.stop();
+		log("Steam callbacks: " + std::to_string(callback_pump.get_dispatched_callback_count()) + " dispatched in " + std::to_string(callback_pump.get_wakeup_count()) + " wakeups.");
+
 		process_manager->deleteLater();
 		mod_manager->deleteLater();
+		mod_index->deleteLater();
+		subscription_manager->deleteLater();
 
-		if (initialized_steam) {
-			SteamAPI_Shutdown();
-		}
+		//wait for initialization to finish before shutting down, in case the launcher was closed before it did
+		initializer.wait_for_finished();
+		steam->shutdown();
 	} catch (const std::exception &exception) {
 		report_exception(exception);
 		result = -1;
 	}
 
+	stop_trace();
 	clean_output();
 
 	return result;
@@ -0,0 +1,109 @@
+#include "mod_file_filter.h"
+
+#include "mod_manifest.h"
+#include "mod_validator.h"
+#include "util.h"
+
+const QStringList mod_file_filter::default_exclude_patterns = {
+	//files written by the launcher, including those which earlier versions wrote into the mod's directory
+	"mod_id.txt",
+	mod_manifest::legacy_filename,
+	mod_validator::legacy_cache_filename,
+
+	//version control
+	".git",
+	".gitignore",
+	".gitattributes",
+	".hg",
+	".svn",
+
+	//editor and operating system leftovers
+	"*~",
+	"*.bak",
+	"*.orig",
+	"*.swp",
+	"*.tmp",
+	".DS_Store",
+	"Thumbs.db",
+	"desktop.ini"
+};
+
+mod_file_filter::mod_file_filter()
+{
+	this->exclude_regular_expressions = mod_file_filter::create_regular_expressions(mod_file_filter::default_exclude_patterns);
+}
+
+void mod_file_filter::set_include_patterns(const QStringList &patterns)
+{
+	this->include_regular_expressions = mod_file_filter::create_regular_expressions(patterns);
+}
+
+void mod_file_filter::add_exclude_patterns(const QStringList &patterns)
+{
+	for (QRegularExpression &regular_expression : mod_file_filter::create_regular_expressions(patterns)) {
+		this->exclude_regular_expressions.push_back(std::move(regular_expression));
+	}
+}
+
+bool mod_file_filter::is_included(const std::filesystem::path &relative_path) const
+{
+	if (this->is_excluded(relative_path)) {
+		return false;
+	}
+
+	if (this->include_regular_expressions.empty()) {
+		return true;
+	}
+
+	return mod_file_filter::matches(this->include_regular_expressions, relative_path);
+}
+
+std::vector<QRegularExpression> mod_file_filter::create_regular_expressions(const QStringList &patterns)
+{
+	std::vector<QRegularExpression> regular_expressions;
+
+	for (const QString &pattern : patterns) {
+		const QString trimmed_pattern = pattern.trimmed();
+
+		if (trimmed_pattern.isEmpty()) {
+			continue;
+		}
+
+		QRegularExpression regular_expression(QRegularExpression::wildcardToRegularExpression(trimmed_pattern));
+
+		if (!regular_expression.isValid()) {
+			throw std::runtime_error("Invalid file pattern: \"" + trimmed_pattern.toStdString() + "\".");
+		}
+
+		//compile the expression now, so that it is not compiled concurrently by multiple threads later
+		regular_expression.optimize();
+
+		regular_expressions.push_back(std::move(regular_expression));
+	}
+
+	return regular_expressions;
+}
+
+bool mod_file_filter::matches(const std::vector<QRegularExpression> &regular_expressions, const std::filesystem::path &relative_path)
+{
+	if (regular_expressions.empty()) {
+		return false;
+	}
+
+	const QString relative_path_qstr = QString::fromStdString(to_generic_string(relative_path));
+	const QVector<QStringRef> components = relative_path_qstr.splitRef('/');
+
+	for (const QRegularExpression &regular_expression : regular_expressions) {
+		if (regular_expression.match(relative_path_qstr).hasMatch()) {
+			return true;
+		}
+
+		for (const QStringRef &component : components) {
+			if (regular_expression.match(component).hasMatch()) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
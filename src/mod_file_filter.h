@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QRegularExpression>
+#include <QStringList>
+
+#include <filesystem>
+#include <vector>
+
+//filter for which of a mod's files are uploaded to the Workshop, based on wildcard patterns
+//a pattern matches a file if it matches either its path relative to the mod directory, or any of the path's components
+class mod_file_filter final
+{
+public:
+	static const QStringList default_exclude_patterns;
+
+	mod_file_filter();
+
+	void set_include_patterns(const QStringList &patterns);
+	void add_exclude_patterns(const QStringList &patterns);
+
+	//these may be called from multiple threads at the same time
+	bool is_included(const std::filesystem::path &relative_path) const;
+
+	bool is_excluded(const std::filesystem::path &relative_path) const
+	{
+		return mod_file_filter::matches(this->exclude_regular_expressions, relative_path);
+	}
+
+private:
+	static std::vector<QRegularExpression> create_regular_expressions(const QStringList &patterns);
+	static bool matches(const std::vector<QRegularExpression> &regular_expressions, const std::filesystem::path &relative_path);
+
+private:
+	std::vector<QRegularExpression> include_regular_expressions; //if empty, all files not excluded are included
+	std::vector<QRegularExpression> exclude_regular_expressions;
+};
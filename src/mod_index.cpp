@@ -0,0 +1,475 @@
+#include "mod_index.h"
+
+#include "mod_manager.h"
+#include "mod_manifest.h"
+#include "mod_upload.h"
+#include "trace.h"
+#include "util.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QGuiApplication>
+#include <QSaveFile>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+std::filesystem::path mod_index::get_mods_path()
+{
+	const std::filesystem::path path = get_user_data_path() / "mods";
+
+	if (!std::filesystem::exists(path)) {
+		const bool success = std::filesystem::create_directories(path);
+		if (!success) {
+			throw std::runtime_error("Failed to create mods path: \"" + path.string() + "\".");
+		}
+	}
+
+	return path;
+}
+
+std::filesystem::path mod_index::get_filepath()
+{
+	const std::filesystem::path user_data_path = get_user_data_path();
+
+	std::filesystem::path filepath = user_data_path / "mod_index.dat";
+	filepath.make_preferred();
+	return filepath;
+}
+
+mod_index::mod_index()
+{
+	this->future_watcher = new QFutureWatcher<std::vector<entry>>(this);
+	connect(this->future_watcher, &QFutureWatcher<std::vector<entry>>::finished, this, &mod_index::on_refreshed);
+
+	this->refresh_timer = new QTimer(this);
+	this->refresh_timer->setSingleShot(true);
+	connect(this->refresh_timer, &QTimer::timeout, this, &mod_index::refresh);
+
+	//changes within a mod's directory, such as its module.txt being edited, are found by checking the modification times when the launcher is returned to, since the mod was most likely edited in another application
+	connect(qGuiApp, &QGuiApplication::applicationStateChanged, this, [this](const Qt::ApplicationState state) {
+		if (state == Qt::ApplicationActive) {
+			this->refresh();
+		}
+	});
+
+	try {
+		this->mods_path = mod_index::get_mods_path();
+
+		//show the mods of the saved index right away, and check them for changes afterwards
+		this->apply_entries(mod_index::load(mod_index::get_filepath()));
+
+		//only the mods directory itself is watched, so that mods being added or removed are noticed without needing a watch for each mod, which would run into the system's limit on watches for large mod libraries
+		this->watcher = new QFileSystemWatcher(this);
+		connect(this->watcher, &QFileSystemWatcher::directoryChanged, this, [this]() {
+			this->refresh_timer->start(mod_index::refresh_delay_ms);
+		});
+
+		if (!this->watcher->addPath(to_qstring(this->mods_path))) {
+			throw std::runtime_error("Failed to watch the mods directory: \"" + to_string(this->mods_path) + "\".");
+		}
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+	}
+
+	this->refresh();
+}
+
+mod_index::~mod_index()
+{
+	//let a refresh in progress finish saving the index
+	this->future_watcher->waitForFinished();
+}
+
+int mod_index::rowCount(const QModelIndex &parent) const
+{
+	if (parent.isValid()) {
+		return 0;
+	}
+
+	return this->get_count();
+}
+
+QVariant mod_index::data(const QModelIndex &index, const int role) const
+{
+	if (!index.isValid() || index.row() < 0 || index.row() >= this->get_count()) {
+		return QVariant();
+	}
+
+	const entry &entry = this->rows[static_cast<size_t>(index.row())];
+	const std::filesystem::path mod_path = this->mods_path / to_path(entry.directory_name);
+
+	switch (role) {
+		case Qt::DisplayRole:
+		case name_role:
+			return entry.name.isEmpty() ? entry.directory_name : entry.name;
+		case path_role:
+			return QUrl::fromLocalFile(to_qstring(mod_path));
+		case published_file_id_role:
+			//passed as a string, since QML numbers cannot represent all 64-bit IDs
+			return entry.published_file_id != 0 ? QString::number(entry.published_file_id) : QString();
+		case preview_role:
+			return entry.preview_filename.isEmpty() ? QUrl() : QUrl::fromLocalFile(to_qstring(mod_path / to_path(entry.preview_filename)));
+		case content_hash_role:
+			return entry.content_hash != 0 ? QString::number(entry.content_hash, 16) : QString();
+		case modified_time_role:
+			return QDateTime::fromMSecsSinceEpoch(entry.modified_time);
+		default:
+			return QVariant();
+	}
+}
+
+QHash<int, QByteArray> mod_index::roleNames() const
+{
+	return {
+		{ name_role, "name" },
+		{ path_role, "path" },
+		{ published_file_id_role, "published_file_id" },
+		{ preview_role, "preview" },
+		{ content_hash_role, "content_hash" },
+		{ modified_time_role, "modified_time" }
+	};
+}
+
+void mod_index::refresh()
+{
+	if (this->mods_path.empty()) {
+		return;
+	}
+
+	if (this->future_watcher->isRunning()) {
+		this->refresh_pending = true;
+		return;
+	}
+
+	std::filesystem::path filepath;
+
+	try {
+		filepath = mod_index::get_filepath();
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+		return;
+	}
+
+	this->future_watcher->setFuture(QtConcurrent::run([mods_path = this->mods_path, filepath, previous_entries = this->entries]() {
+		trace_span span("refresh_mod_index", "mods");
+
+		try {
+			std::vector<entry> new_entries = mod_index::scan(mods_path, previous_entries);
+
+			if (new_entries != previous_entries) {
+				mod_index::save(filepath, new_entries);
+			}
+
+			span.add_arg("mod_count", new_entries.size());
+			return new_entries;
+		} catch (const std::exception &exception) {
+			report_exception(exception);
+			return previous_entries;
+		}
+	}));
+
+	emit refreshingChanged();
+}
+
+void mod_index::check_mod(const QString &directory_name)
+{
+	if (this->mods_path.empty()) {
+		return;
+	}
+
+	const auto find_iterator = std::find_if(this->entries.begin(), this->entries.end(), [&directory_name](const entry &entry) {
+		return entry.directory_name == directory_name;
+	});
+
+	if (find_iterator == this->entries.end()) {
+		return;
+	}
+
+	//only the one mod is checked, and the whole index is only refreshed if it has changed
+	std::error_code error_code;
+	const std::filesystem::directory_entry dir_entry(this->mods_path / to_path(directory_name), error_code);
+
+	qint64 modified_time = 0;
+	if (error_code || !mod_index::get_modified_time(dir_entry, modified_time) || modified_time != find_iterator->modified_time) {
+		this->refresh();
+	}
+}
+
+void mod_index::set_filter(const QString &filter)
+{
+	if (filter == this->filter) {
+		return;
+	}
+
+	this->filter = filter;
+	emit filterChanged();
+
+	const int old_count = this->get_count();
+
+	//filtering only goes through the entries in memory, so it is fast enough to be done on every keystroke
+	this->beginResetModel();
+	this->rows.clear();
+	std::copy_if(this->entries.begin(), this->entries.end(), std::back_inserter(this->rows), [this](const entry &entry) {
+		return this->matches_filter(entry);
+	});
+	this->endResetModel();
+
+	if (this->get_count() != old_count) {
+		emit countChanged();
+	}
+}
+
+std::vector<mod_index::entry> mod_index::load(const std::filesystem::path &filepath)
+{
+	QFile file(to_qstring(filepath));
+
+	if (!file.exists()) {
+		return {};
+	}
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		throw std::runtime_error("Failed to open the mod index for reading.");
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_12);
+
+	quint32 signature = 0;
+	quint32 version = 0;
+	quint32 entry_count = 0;
+	stream >> signature >> version >> entry_count;
+
+	//an index in another format is discarded, and rebuilt by the next refresh
+	if (stream.status() != QDataStream::Ok || signature != mod_index::file_signature || version != mod_index::file_version) {
+		log("The mod index is in an outdated format, and will be rebuilt.");
+		return {};
+	}
+
+	std::vector<entry> entries;
+	entries.reserve(std::min<quint32>(entry_count, 65536));
+
+	for (quint32 i = 0; i < entry_count; ++i) {
+		entry entry;
+		stream >> entry.directory_name >> entry.name >> entry.published_file_id >> entry.preview_filename >> entry.content_hash >> entry.modified_time;
+
+		if (stream.status() != QDataStream::Ok) {
+			log_error("The mod index is corrupt, and will be rebuilt.");
+			return {};
+		}
+
+		entries.push_back(std::move(entry));
+	}
+
+	std::sort(entries.begin(), entries.end(), mod_index::is_ordered_before);
+
+	return entries;
+}
+
+void mod_index::save(const std::filesystem::path &filepath, const std::vector<entry> &entries)
+{
+	//the file is replaced in one step when committed, so that an interrupted write cannot leave it incomplete
+	QSaveFile file(to_qstring(filepath));
+
+	if (!file.open(QIODevice::WriteOnly)) {
+		throw std::runtime_error("Failed to open the mod index for writing.");
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_12);
+
+	stream << mod_index::file_signature << mod_index::file_version << static_cast<quint32>(entries.size());
+
+	for (const entry &entry : entries) {
+		stream << entry.directory_name << entry.name << entry.published_file_id << entry.preview_filename << entry.content_hash << entry.modified_time;
+	}
+
+	if (stream.status() != QDataStream::Ok || !file.commit()) {
+		throw std::runtime_error("Failed to write the mod index.");
+	}
+}
+
+std::vector<mod_index::entry> mod_index::scan(const std::filesystem::path &mods_path, const std::vector<entry> &previous_entries)
+{
+	std::map<QString, const entry *> previous_entries_by_directory;
+	for (const entry &previous_entry : previous_entries) {
+		previous_entries_by_directory[previous_entry.directory_name] = &previous_entry;
+	}
+
+	std::vector<entry> entries;
+
+	for (const std::filesystem::directory_entry &dir_entry : std::filesystem::directory_iterator(mods_path, std::filesystem::directory_options::skip_permission_denied)) {
+		std::error_code error_code;
+
+		if (!dir_entry.is_directory(error_code)) {
+			continue;
+		}
+
+		qint64 modified_time_ms = 0;
+		if (!mod_index::get_modified_time(dir_entry, modified_time_ms)) {
+			continue;
+		}
+
+		const auto find_iterator = previous_entries_by_directory.find(to_qstring(dir_entry.path().filename()));
+		if (find_iterator != previous_entries_by_directory.end() && find_iterator->second->modified_time == modified_time_ms) {
+			entries.push_back(*find_iterator->second);
+			continue;
+		}
+
+		try {
+			entries.push_back(mod_index::read_entry(dir_entry.path(), modified_time_ms));
+		} catch (const std::exception &exception) {
+			report_exception(exception);
+			log_error("Failed to index the mod in \"" + to_string(dir_entry.path()) + "\".");
+		}
+	}
+
+	std::sort(entries.begin(), entries.end(), mod_index::is_ordered_before);
+
+	return entries;
+}
+
+mod_index::entry mod_index::read_entry(const std::filesystem::path &mod_path, const qint64 modified_time)
+{
+	mod_data mod_data;
+	mod_data.path = mod_path;
+
+	mod_manager::parse_mod(mod_data);
+
+	if (std::filesystem::exists(mod_data.get_mod_id_filepath())) {
+		mod_manager::read_mod_id(mod_data);
+	}
+
+	entry entry;
+	entry.directory_name = to_qstring(mod_path.filename());
+	entry.name = QString::fromStdString(mod_data.name);
+	entry.published_file_id = mod_data.published_file_id;
+	entry.modified_time = modified_time;
+
+	const std::filesystem::path image_filepath = mod_data.find_image_filepath();
+	if (!image_filepath.empty()) {
+		entry.preview_filename = to_qstring(image_filepath.filename());
+	}
+
+	//the files are not hashed here, so the hash is the one from the last time the mod was validated or uploaded
+	mod_data.manifest.load(mod_path);
+	entry.content_hash = mod_data.manifest.get_content_hash();
+
+	return entry;
+}
+
+bool mod_index::get_modified_time(const std::filesystem::directory_entry &dir_entry, qint64 &modified_time)
+{
+	mod_data mod_data;
+	mod_data.path = dir_entry.path();
+
+	//only the directory and the files the entry is read from are checked, so that an unchanged mod needs no more than three metadata reads; adding or replacing any other file, e.g. the preview image, changes the directory's modification time
+	std::error_code error_code;
+	std::filesystem::file_time_type latest_time = dir_entry.last_write_time(error_code);
+	if (error_code) {
+		return false;
+	}
+
+	const std::filesystem::file_time_type mod_file_time = std::filesystem::last_write_time(mod_data.get_mod_filepath(), error_code);
+	if (error_code) {
+		//not a mod
+		return false;
+	}
+
+	latest_time = std::max(latest_time, mod_file_time);
+
+	const std::filesystem::file_time_type mod_id_time = std::filesystem::last_write_time(mod_data.get_mod_id_filepath(), error_code);
+	if (!error_code) {
+		latest_time = std::max(latest_time, mod_id_time);
+	}
+
+	modified_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::file_clock::to_sys(latest_time).time_since_epoch()).count();
+	return true;
+}
+
+bool mod_index::is_ordered_before(const entry &lhs, const entry &rhs)
+{
+	const QString &lhs_name = lhs.name.isEmpty() ? lhs.directory_name : lhs.name;
+	const QString &rhs_name = rhs.name.isEmpty() ? rhs.directory_name : rhs.name;
+
+	const int result = QString::compare(lhs_name, rhs_name, Qt::CaseInsensitive);
+	if (result != 0) {
+		return result < 0;
+	}
+
+	return lhs.directory_name < rhs.directory_name;
+}
+
+bool mod_index::matches_filter(const entry &entry) const
+{
+	if (this->filter.isEmpty()) {
+		return true;
+	}
+
+	return entry.name.contains(this->filter, Qt::CaseInsensitive) || entry.directory_name.contains(this->filter, Qt::CaseInsensitive);
+}
+
+void mod_index::on_refreshed()
+{
+	this->apply_entries(this->future_watcher->result());
+
+	emit refreshingChanged();
+
+	if (this->refresh_pending) {
+		this->refresh_pending = false;
+		this->refresh();
+	}
+}
+
+void mod_index::apply_entries(std::vector<entry> &&new_entries)
+{
+	this->entries = std::move(new_entries);
+
+	std::vector<entry> new_rows;
+	std::copy_if(this->entries.begin(), this->entries.end(), std::back_inserter(new_rows), [this](const entry &entry) {
+		return this->matches_filter(entry);
+	});
+
+	const int old_count = this->get_count();
+
+	if (this->rows.empty() || new_rows.empty()) {
+		this->beginResetModel();
+		this->rows = std::move(new_rows);
+		this->endResetModel();
+	} else {
+		//update the rows in place, so that views keep their position and only the changed mods are redrawn
+		//both lists are in the same order, so they can be merged in a single pass
+		size_t row = 0;
+		size_t new_row = 0;
+
+		while (row < this->rows.size() || new_row < new_rows.size()) {
+			if (new_row == new_rows.size() || (row < this->rows.size() && mod_index::is_ordered_before(this->rows[row], new_rows[new_row]))) {
+				this->beginRemoveRows(QModelIndex(), static_cast<int>(row), static_cast<int>(row));
+				this->rows.erase(this->rows.begin() + static_cast<std::ptrdiff_t>(row));
+				this->endRemoveRows();
+				continue;
+			}
+
+			if (row == this->rows.size() || mod_index::is_ordered_before(new_rows[new_row], this->rows[row])) {
+				this->beginInsertRows(QModelIndex(), static_cast<int>(row), static_cast<int>(row));
+				this->rows.insert(this->rows.begin() + static_cast<std::ptrdiff_t>(row), std::move(new_rows[new_row]));
+				this->endInsertRows();
+			} else if (this->rows[row] != new_rows[new_row]) {
+				this->rows[row] = std::move(new_rows[new_row]);
+				emit dataChanged(this->index(static_cast<int>(row)), this->index(static_cast<int>(row)));
+			}
+
+			++row;
+			++new_row;
+		}
+	}
+
+	if (this->get_count() != old_count) {
+		emit countChanged();
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QFutureWatcher>
+#include <QString>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+class QFileSystemWatcher;
+class QTimer;
+
+//index of the mods in the user data directory, which can be listed and filtered from QML without reading the mods' files
+//the index is stored in a binary file, and is refreshed on a worker thread, where only the mods whose files changed since the last refresh are read again
+class mod_index final : public QAbstractListModel
+{
+	Q_OBJECT
+
+	Q_PROPERTY(QString filter READ get_filter WRITE set_filter NOTIFY filterChanged)
+	Q_PROPERTY(int count READ get_count NOTIFY countChanged)
+	Q_PROPERTY(bool refreshing READ is_refreshing NOTIFY refreshingChanged)
+
+public:
+	enum role {
+		name_role = Qt::UserRole + 1,
+		path_role,
+		published_file_id_role,
+		preview_role,
+		content_hash_role,
+		modified_time_role
+	};
+
+	static constexpr quint32 file_signature = 0x574D4958;
+	static constexpr quint32 file_version = 1;
+	static constexpr int refresh_delay_ms = 500; //the delay before refreshing after a change in the mods directory, so that a mod being copied is only read once
+
+	struct entry final
+	{
+		QString directory_name;
+		QString name;
+		quint64 published_file_id = 0;
+		QString preview_filename; //the filename of the preview image in the mod directory, or empty if there is none
+		quint64 content_hash = 0; //the hash of the mod's files as of the last time they were hashed, or 0 if they never were
+		qint64 modified_time = 0; //the latest modification time of the mod's directory and its module.txt and mod_id.txt files, in milliseconds since the Unix epoch
+
+		bool operator==(const entry &other) const = default;
+	};
+
+	static std::filesystem::path get_mods_path();
+	static std::filesystem::path get_filepath();
+
+	mod_index();
+	~mod_index();
+
+	virtual int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+	virtual QVariant data(const QModelIndex &index, const int role = Qt::DisplayRole) const override;
+	virtual QHash<int, QByteArray> roleNames() const override;
+
+	//check the mods directory for changes on a worker thread; if a refresh is already in progress, another one follows it
+	Q_INVOKABLE void refresh();
+
+	//check whether a mod's files have changed since it was indexed, e.g. when it is opened, and refresh if they have
+	Q_INVOKABLE void check_mod(const QString &directory_name);
+
+	const QString &get_filter() const
+	{
+		return this->filter;
+	}
+
+	void set_filter(const QString &filter);
+
+	int get_count() const
+	{
+		return static_cast<int>(this->rows.size());
+	}
+
+	bool is_refreshing() const
+	{
+		return this->future_watcher->isRunning();
+	}
+
+signals:
+	void filterChanged();
+	void countChanged();
+	void refreshingChanged();
+
+private:
+	//functions for reading and writing the index, which are called from a worker thread
+	static std::vector<entry> load(const std::filesystem::path &filepath);
+	static void save(const std::filesystem::path &filepath, const std::vector<entry> &entries);
+	static std::vector<entry> scan(const std::filesystem::path &mods_path, const std::vector<entry> &previous_entries);
+	static entry read_entry(const std::filesystem::path &mod_path, const qint64 modified_time);
+
+	//get the latest modification time of the mod's directory and the files its entry is read from, in milliseconds since the Unix epoch; returns false if the directory is not a mod
+	static bool get_modified_time(const std::filesystem::directory_entry &dir_entry, qint64 &modified_time);
+
+	static bool is_ordered_before(const entry &lhs, const entry &rhs);
+
+	bool matches_filter(const entry &entry) const;
+	void on_refreshed();
+	void apply_entries(std::vector<entry> &&new_entries);
+
+private:
+	std::filesystem::path mods_path;
+	std::vector<entry> entries; //all indexed mods, ordered by name
+	std::vector<entry> rows; //the mods which pass the filter, in the same order
+	QString filter;
+	QFutureWatcher<std::vector<entry>> *future_watcher = nullptr;
+	bool refresh_pending = false;
+	QFileSystemWatcher *watcher = nullptr;
+	QTimer *refresh_timer = nullptr;
+};
@@ -1,62 +1,190 @@
 #include "mod_manager.h"
 
+#include "hash_util.h"
+#include "mod_staging.h"
+#include "mod_upload.h"
+#include "preview_optimizer.h"
+#include "steam_backend.h"
+#include "steam_initializer.h"
+#include "trace.h"
 #include "util.h"
 
-#include "steam/isteamugc.h"
-
+#include <QFutureWatcher>
+#include <QPointer>
+#include <QQmlEngine>
 #include <QSettings>
+#include <QtConcurrent>
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 
-QString mod_manager::upload_mod(const QUrl &mod_dir_url)
+mod_upload *mod_manager::upload_mod(const QUrl &mod_dir_url)
 {
-	this->mod_data = std::make_unique<::mod_data>();
+	trace_span span("upload_mod", "upload");
 
-	try {
-		const std::filesystem::path mod_dir_path = to_path(mod_dir_url);
+	std::filesystem::path mod_dir_path = to_path(mod_dir_url).lexically_normal();
+	if (!mod_dir_path.has_filename()) {
+		//remove the trailing separator, so that the same directory always has the same key
+		mod_dir_path = mod_dir_path.parent_path();
+	}
+
+	const auto find_iterator = this->uploads.find(mod_dir_path);
+	if (find_iterator != this->uploads.end()) {
+		mod_upload *existing_upload = find_iterator->second;
 
-		if (!std::filesystem::exists(mod_dir_path)) {
-			throw std::runtime_error("The mod directory does not exist.");
+		if (!existing_upload->is_finished()) {
+			return existing_upload;
 		}
 
-		this->mod_data->path = mod_dir_path;
+		existing_upload->deleteLater();
+		this->uploads.erase(find_iterator);
+	}
+
+	mod_upload *upload = new mod_upload(mod_dir_path, this);
+	QQmlEngine::setObjectOwnership(upload, QQmlEngine::CppOwnership);
+	this->uploads[mod_dir_path] = upload;
 
-		this->parse_mod();
+	connect(upload, &mod_upload::stateChanged, this, [this, upload]() {
+		emit modUploadStateChanged(upload->get_mod_path(), upload->get_state());
+	});
 
-		ISteamUGC *ugc = SteamUGC();
+	//prepare the upload on a worker thread, since it involves file system access which can be slow, e.g. for mods on network drives
+	QFutureWatcher<QString> *watcher = new QFutureWatcher<QString>(upload);
+	connect(watcher, &QFutureWatcher<QString>::finished, upload, [this, upload, watcher]() {
+		watcher->deleteLater();
+		this->on_mod_prepared(upload, watcher->result());
+	});
 
-		if (ugc == nullptr) {
-			throw std::runtime_error("No Steam user information provided.");
+	watcher->setFuture(QtConcurrent::run([mod_data = upload->get_mod_data()]() {
+		try {
+			mod_manager::prepare_mod(*mod_data);
+			return QString();
+		} catch (const std::exception &exception) {
+			//the exception is reported when the upload is failed on the GUI thread
+			return QString(exception.what());
 		}
+	}));
+
+	return upload;
+}
 
-		const std::filesystem::path mod_id_filepath = this->get_mod_id_filepath();
-		if (std::filesystem::exists(mod_id_filepath)) {
-			this->read_mod_id();
+QVariantList mod_manager::get_uploads() const
+{
+	QVariantList uploads;
 
-			//if we already have a mod ID, we don't need to create the item, just update its contents
-			this->update_mod_content();
+	for (const auto &[mod_path, upload] : this->uploads) {
+		uploads.push_back(QVariant::fromValue(upload));
+	}
 
-			return QString();
+	return uploads;
+}
+
+void mod_manager::set_max_concurrent_uploads(const int max_concurrent_uploads)
+{
+	const int new_max_concurrent_uploads = std::max(1, max_concurrent_uploads);
+
+	if (new_max_concurrent_uploads == this->max_concurrent_uploads) {
+		return;
+	}
+
+	this->max_concurrent_uploads = new_max_concurrent_uploads;
+	emit maxConcurrentUploadsChanged();
+
+	this->start_queued_uploads();
+}
+
+mod_validator::result mod_manager::validate_mod(mod_data &mod_data)
+{
+	if (!std::filesystem::exists(mod_data.path)) {
+		throw std::runtime_error("The mod directory does not exist.");
+	}
+
+	trace_span parse_span("parse_mod", "upload");
+
+	mod_manager::parse_mod(mod_data);
+
+	std::vector<mod_validator::problem> id_problems;
+
+	if (std::filesystem::exists(mod_data.get_mod_id_filepath())) {
+		try {
+			mod_manager::read_mod_id(mod_data);
+		} catch (const std::exception &exception) {
+			id_problems.push_back({ "mod_id.txt", exception.what() });
 		}
+	}
 
-		const SteamAPICall_t call_handle = ugc->CreateItem(app_id, EWorkshopFileType::k_EWorkshopFileTypeCommunity);
-		this->mod_data->create_item_call_result.Set(call_handle, this, &mod_manager::on_item_created);
+	mod_data.image_filepath = mod_data.find_image_filepath();
 
-		return QString();
-	} catch (const std::exception &exception) {
-		report_exception(exception);
+	parse_span.end();
+
+	trace_span validate_span("validate_mod", "upload");
 
-		return exception.what();
+	mod_validator::result validation_result = mod_validator::validate(mod_data);
+	validation_result.problems.insert(validation_result.problems.begin(), id_problems.begin(), id_problems.end());
+
+	validate_span.add_arg("file_count", validation_result.file_count);
+	validate_span.add_arg("problem_count", validation_result.problems.size());
+
+	return validation_result;
+}
+
+void mod_manager::update_manifest(mod_data &mod_data)
+{
+	trace_span manifest_span("update_manifest", "upload");
+
+	mod_data.manifest.load(mod_data.path);
+	mod_data.manifest.update(mod_data.file_filter);
+
+	//save the updated file hashes right away, so that they need not be computed again even if the upload fails
+	mod_data.manifest.save();
+
+	manifest_span.add_arg("file_count", mod_data.manifest.get_files().size());
+}
+
+void mod_manager::prepare_mod(mod_data &mod_data)
+{
+	trace_span span("prepare_mod", "upload");
+	span.add_arg("mod", to_generic_string(mod_data.path));
+
+	//validate the mod before hashing and staging its files, so that a malformed mod fails without any further work
+	const mod_validator::result validation_result = mod_manager::validate_mod(mod_data);
+
+	if (!validation_result.problems.empty()) {
+		throw std::runtime_error(mod_validator::describe_problems(validation_result.problems));
+	}
+
+	mod_manager::update_manifest(mod_data);
+
+	if (!mod_data.image_filepath.empty()) {
+		trace_span preview_span("prepare_preview", "upload");
+
+		mod_data.preview_hash = mod_data.manifest.get_file_hash(mod_data.image_filepath.lexically_relative(mod_data.path));
+
+		if (mod_data.preview_hash == 0) {
+			//the image is not part of the uploaded files, so it is not in the manifest
+			mod_data.preview_hash = mod_manifest::hash_file(mod_data.image_filepath);
+		}
+
+		if (!mod_data.manifest.is_preview_published(mod_data.published_file_id, mod_data.preview_hash)) {
+			mod_data.preview_filepath = preview_optimizer::optimize(mod_data.image_filepath, mod_data.preview_hash);
+		}
+	}
+
+	if (!mod_data.manifest.is_content_published(mod_data.published_file_id)) {
+		trace_span staging_span("stage_content", "upload");
+		mod_staging::update(mod_data.path, mod_data.manifest);
+		mod_data.content_path = mod_staging::get_staging_path(mod_data.path);
 	}
 }
 
-void mod_manager::parse_mod()
+void mod_manager::parse_mod(mod_data &mod_data)
 {
-	const std::filesystem::path mod_filepath = this->get_mod_filepath();
+	const std::filesystem::path mod_filepath = mod_data.get_mod_filepath();
 
+	//a missing file is reported by the validation, together with the mod's other problems
 	if (!std::filesystem::exists(mod_filepath)) {
-		throw std::runtime_error("The module.txt file is missing for the mod.");
+		return;
 	}
 
 	const QString mod_filepath_qstr = to_qstring(mod_filepath);
@@ -64,18 +192,18 @@ void mod_manager::parse_mod()
 
 	for (const QString &key : mod_info.childKeys()) {
 		if (key == "name") {
-			this->mod_data->name = mod_info.value(key).toString().toStdString();
+			mod_data.name = mod_info.value(key).toString().toStdString();
+		} else if (key == "upload_include") {
+			mod_data.file_filter.set_include_patterns(mod_info.value(key).toStringList());
+		} else if (key == "upload_exclude") {
+			mod_data.file_filter.add_exclude_patterns(mod_info.value(key).toStringList());
 		}
 	}
-
-	if (this->mod_data->name.empty()) {
-		throw std::runtime_error("The mod has no name.");
-	}
 }
 
-void mod_manager::read_mod_id()
+void mod_manager::read_mod_id(mod_data &mod_data)
 {
-	const std::filesystem::path mod_id_filepath = this->get_mod_id_filepath();
+	const std::filesystem::path mod_id_filepath = mod_data.get_mod_id_filepath();
 
 	std::ifstream ifstream(mod_id_filepath);
 
@@ -90,12 +218,85 @@ void mod_manager::read_mod_id()
 		throw std::runtime_error("The mod_id.txt file does not contain an ID.");
 	}
 
-	this->mod_data->published_file_id = std::stoull(mod_id_str);
+	mod_data.published_file_id = std::stoull(mod_id_str);
+}
+
+void mod_manager::on_mod_prepared(mod_upload *upload, const QString &error_message)
+{
+	if (!error_message.isEmpty()) {
+		this->fail_upload(upload, std::runtime_error(error_message.toStdString()));
+		return;
+	}
+
+	upload->set_state(mod_upload::upload_state::queued);
+	this->queued_uploads.push_back(upload);
+	this->start_queued_uploads();
 }
 
-void mod_manager::write_mod_id(const uint64_t published_file_id)
+void mod_manager::start_queued_uploads()
 {
-	const std::filesystem::path mod_id_filepath = this->get_mod_id_filepath();
+	if (!this->queued_uploads.empty() && !this->steam_wait_pending) {
+		steam_initializer *initializer = steam_initializer::get();
+
+		if (initializer != nullptr && !initializer->is_finished()) {
+			//the uploads remain queued until Steam has been initialized
+			this->steam_wait_pending = true;
+			steam_initializer::call_when_finished(this, [this]() {
+				this->steam_wait_pending = false;
+				this->start_queued_uploads();
+			});
+		}
+	}
+
+	if (this->steam_wait_pending) {
+		return;
+	}
+
+	while (this->active_upload_count < this->max_concurrent_uploads && !this->queued_uploads.empty()) {
+		mod_upload *upload = this->queued_uploads.front();
+		this->queued_uploads.pop_front();
+
+		++this->active_upload_count;
+
+		try {
+			this->start_upload(upload);
+		} catch (const std::exception &exception) {
+			this->fail_upload(upload, exception);
+		}
+	}
+}
+
+void mod_manager::start_upload(mod_upload *upload)
+{
+	//if we already have a mod ID, we don't need to create the item, just update its contents
+	const bool has_published_file_id = upload->get_mod_data()->published_file_id != 0;
+
+	//set the state before anything can fail, so that the upload's slot is released on failure
+	upload->set_state(has_published_file_id ? mod_upload::upload_state::updating : mod_upload::upload_state::creating);
+
+	steam_backend *steam = steam_backend::get();
+
+	if (!steam->is_ugc_available()) {
+		throw std::runtime_error("No Steam user information provided.");
+	}
+
+	if (has_published_file_id) {
+		this->update_mod_content(upload);
+		return;
+	}
+
+	steam->create_item(app_id, EWorkshopFileType::k_EWorkshopFileTypeCommunity, [this, upload = QPointer<mod_upload>(upload)](CreateItemResult_t *result, const bool io_failure) {
+		if (upload == nullptr) {
+			return;
+		}
+
+		this->on_item_created(upload, result, io_failure);
+	});
+}
+
+void mod_manager::write_mod_id(const mod_data &mod_data, const uint64_t published_file_id)
+{
+	const std::filesystem::path mod_id_filepath = mod_data.get_mod_id_filepath();
 
 	std::ofstream ofstream(mod_id_filepath);
 
@@ -106,36 +307,66 @@ void mod_manager::write_mod_id(const uint64_t published_file_id)
 	ofstream << published_file_id;
 }
 
-void mod_manager::update_mod_content()
+void mod_manager::update_mod_content(mod_upload *upload)
 {
-	const uint64_t mod_id = this->mod_data->published_file_id;
+	const mod_data &mod_data = *upload->get_mod_data();
+	const uint64_t mod_id = mod_data.published_file_id;
+
+	//only send what changed since the mod was last published
+	const uint64_t title_hash = hash_string(mod_data.name);
+	const bool title_changed = !mod_data.manifest.is_title_published(mod_id, title_hash);
+	const bool content_changed = !mod_data.manifest.is_content_published(mod_id);
+	const bool preview_changed = !mod_data.image_filepath.empty() && !mod_data.manifest.is_preview_published(mod_id, mod_data.preview_hash);
+
+	if (!title_changed && !content_changed && !preview_changed) {
+		log("The mod \"" + mod_data.name + "\" has not changed since it was last published.");
+		this->complete_upload(upload);
+		return;
+	}
+
+	steam_backend *steam = steam_backend::get();
+	const UGCUpdateHandle_t update_handle = steam->start_item_update(app_id, mod_id);
+
+	if (update_handle == k_UGCUpdateHandleInvalid) {
+		throw std::runtime_error("Failed to start item update.");
+	}
 
-	ISteamUGC *ugc = SteamUGC();
-	const UGCUpdateHandle_t update_handle = ugc->StartItemUpdate(app_id, mod_id);
+	bool success = false;
 
-	bool success = ugc->SetItemTitle(update_handle, this->mod_data->name.c_str());
+	if (title_changed) {
+		success = steam->set_item_title(update_handle, mod_data.name.c_str());
 
-	if (!success) {
-		throw std::runtime_error("Failed to set item title.");
+		if (!success) {
+			throw std::runtime_error("Failed to set item title.");
+		}
 	}
-	
-	success = ugc->SetItemContent(update_handle, to_string(this->mod_data->path).c_str());
 
-	if (!success) {
-		throw std::runtime_error("Failed to set item content.");
+	if (content_changed) {
+		success = steam->set_item_content(update_handle, to_string(mod_data.content_path).c_str());
+
+		if (!success) {
+			throw std::runtime_error("Failed to set item content.");
+		}
 	}
 
-	const std::filesystem::path image_filepath = this->get_mod_image_filepath();
-	if (!image_filepath.empty()) {
-		success = ugc->SetItemPreview(update_handle, to_string(image_filepath).c_str());
+	if (preview_changed) {
+		success = steam->set_item_preview(update_handle, to_string(mod_data.preview_filepath).c_str());
 
 		if (!success) {
 			throw std::runtime_error("Failed to set item preview image.");
 		}
 	}
 
-	const SteamAPICall_t call_handle = ugc->SubmitItemUpdate(update_handle, nullptr);
-	this->mod_data->update_item_call_result.Set(call_handle, this, &mod_manager::on_item_updated);
+	//the tracking is started first, since the result function can be called right away, finishing the upload
+	upload->start_progress_tracking(update_handle);
+
+	steam->submit_item_update(update_handle, nullptr, [this, upload = QPointer<mod_upload>(upload)](SubmitItemUpdateResult_t *result, const bool io_failure) {
+		if (upload == nullptr) {
+			return;
+		}
+
+		this->on_item_updated(upload, result, io_failure);
+	});
 }
 
 void mod_manager::process_call_result_code(const EResult result_code)
@@ -176,7 +407,7 @@ void mod_manager::process_call_result_code(const EResult result_code)
 	}
 }
 
-void mod_manager::on_item_created(CreateItemResult_t *result, const bool io_failure)
+void mod_manager::on_item_created(mod_upload *upload, CreateItemResult_t *result, const bool io_failure)
 {
 	try {
 		if (io_failure) {
@@ -189,19 +420,18 @@ void mod_manager::on_item_created(CreateItemResult_t *result, const bool io_fail
 			throw std::runtime_error("The user needs to accept the Steam Workshop legal agreement.");
 		}
 
-		this->write_mod_id(result->m_nPublishedFileId);
+		this->write_mod_id(*upload->get_mod_data(), result->m_nPublishedFileId);
 
-		this->mod_data->published_file_id = result->m_nPublishedFileId;
+		upload->get_mod_data()->published_file_id = result->m_nPublishedFileId;
 
-		this->update_mod_content();
+		upload->set_state(mod_upload::upload_state::updating);
+		this->update_mod_content(upload);
 	} catch (const std::exception &exception) {
-		report_exception(exception);
-
-		emit modUploadFailed(exception.what());
+		this->fail_upload(upload, exception);
 	}
 }
 
-void mod_manager::on_item_updated(SubmitItemUpdateResult_t *result, const bool io_failure)
+void mod_manager::on_item_updated(mod_upload *upload, SubmitItemUpdateResult_t *result, const bool io_failure)
 {
 	try {
 		if (io_failure) {
@@ -214,10 +444,54 @@ void mod_manager::on_item_updated(SubmitItemUpdateResult_t *result, const bool i
 			throw std::runtime_error("The user needs to accept the Steam Workshop legal agreement.");
 		}
 
-		emit modUploadCompleted();
+		this->save_published_state(*upload->get_mod_data());
+		this->complete_upload(upload);
 	} catch (const std::exception &exception) {
+		this->fail_upload(upload, exception);
+	}
+}
+
+void mod_manager::save_published_state(mod_data &mod_data)
+{
+	try {
+		mod_data.manifest.set_published(mod_data.published_file_id, hash_string(mod_data.name), mod_data.preview_hash);
+		mod_data.manifest.save();
+	} catch (const std::exception &exception) {
+		//the upload itself succeeded, so only report the error; the next upload will then send the mod in full
 		report_exception(exception);
+	}
+}
 
-		emit modUploadFailed(exception.what());
+void mod_manager::complete_upload(mod_upload *upload)
+{
+	this->release_upload_slot(upload);
+
+	upload->complete();
+	emit modUploadCompleted(upload->get_mod_path());
+
+	this->start_queued_uploads();
+}
+
+void mod_manager::fail_upload(mod_upload *upload, const std::exception &exception)
+{
+	report_exception(exception);
+
+	this->release_upload_slot(upload);
+
+	upload->fail(exception.what());
+	emit modUploadFailed(upload->get_mod_path(), exception.what());
+
+	this->start_queued_uploads();
+}
+
+void mod_manager::release_upload_slot(mod_upload *upload)
+{
+	switch (upload->get_state()) {
+		case mod_upload::upload_state::creating:
+		case mod_upload::upload_state::updating:
+			--this->active_upload_count;
+			break;
+		default:
+			break;
 	}
 }
@@ -1,80 +1,80 @@
 #pragma once
 
+#include "mod_upload.h"
+#include "mod_validator.h"
+
 #include "steam/isteamugc.h"
-#include "steam/steam_api_common.h"
 
 #include <QObject>
+#include <QVariantList>
 #include <QUrl>
 
+#include <deque>
 #include <filesystem>
-
-class mod_manager;
-
-struct mod_data final
-{
-	std::filesystem::path path;
-	std::string name;
-	uint64_t published_file_id = 0;
-	CCallResult<mod_manager, CreateItemResult_t> create_item_call_result;
-	CCallResult<mod_manager, SubmitItemUpdateResult_t> update_item_call_result;
-};
+#include <map>
 
 class mod_manager final : public QObject
 {
 	Q_OBJECT
 
+	Q_PROPERTY(int max_concurrent_uploads READ get_max_concurrent_uploads WRITE set_max_concurrent_uploads NOTIFY maxConcurrentUploadsChanged)
+
 public:
-	Q_INVOKABLE QString upload_mod(const QUrl &mod_dir_url);
+	static constexpr int default_max_concurrent_uploads = 2;
 
-private:
-	std::filesystem::path get_mod_filepath() const
-	{
-		return this->mod_data->path / "module.txt";
-	}
+	//read a mod's information and check it for problems; this is done on a worker thread before uploading, but can also be used to validate a mod by itself
+	static mod_validator::result validate_mod(mod_data &mod_data);
 
-	std::filesystem::path get_mod_id_filepath() const
-	{
-		return this->mod_data->path / "mod_id.txt";
-	}
+	//update the hashes of a validated mod's files
+	static void update_manifest(mod_data &mod_data);
+
+	//read the mod's module.txt file, without validating it
+	static void parse_mod(mod_data &mod_data);
+
+	static void read_mod_id(mod_data &mod_data);
+
+	//start uploading a mod; the mod is prepared on a worker thread, and the returned object can be used to follow the upload's progress
+	//if the mod is already being uploaded, the existing upload is returned
+	Q_INVOKABLE mod_upload *upload_mod(const QUrl &mod_dir_url);
 
-	std::filesystem::path get_mod_image_filepath() const
+	Q_INVOKABLE QVariantList get_uploads() const;
+
+	int get_max_concurrent_uploads() const
 	{
-		std::filesystem::path filepath = this->mod_data->path / "module.png";
-		if (std::filesystem::exists(filepath)) {
-			return filepath;
-		}
-
-		filepath.replace_extension(".jpg");
-		if (std::filesystem::exists(filepath)) {
-			return filepath;
-		}
-
-		filepath.replace_extension(".jpeg");
-		if (std::filesystem::exists(filepath)) {
-			return filepath;
-		}
-
-		filepath.replace_extension(".gif");
-		if (std::filesystem::exists(filepath)) {
-			return filepath;
-		}
-
-		return std::filesystem::path();
+		return this->max_concurrent_uploads;
 	}
 
-	void parse_mod();
-	void read_mod_id();
-	void write_mod_id(const uint64_t published_file_id);
-	void update_mod_content();
+	void set_max_concurrent_uploads(const int max_concurrent_uploads);
+
+private:
+	//prepare the upload; this is called from a worker thread
+	static void prepare_mod(mod_data &mod_data);
+
+	void on_mod_prepared(mod_upload *upload, const QString &error_message);
+	void start_queued_uploads();
+	void start_upload(mod_upload *upload);
+	void write_mod_id(const mod_data &mod_data, const uint64_t published_file_id);
+	void update_mod_content(mod_upload *upload);
 	void process_call_result_code(const EResult result_code);
 
-	void on_item_created(CreateItemResult_t *result, const bool io_failure);
-	void on_item_updated(SubmitItemUpdateResult_t *result, const bool io_failure);
+	void on_item_created(mod_upload *upload, CreateItemResult_t *result, const bool io_failure);
+	void on_item_updated(mod_upload *upload, SubmitItemUpdateResult_t *result, const bool io_failure);
+
+	void save_published_state(mod_data &mod_data);
+	void complete_upload(mod_upload *upload);
+	void fail_upload(mod_upload *upload, const std::exception &exception);
+	void release_upload_slot(mod_upload *upload);
 
 signals:
-	void modUploadCompleted();
-	void modUploadFailed(const QString &error_message);
+	void maxConcurrentUploadsChanged();
+	void modUploadStateChanged(const QString &mod_path, const mod_upload::upload_state state);
+	void modUploadCompleted(const QString &mod_path);
+	void modUploadFailed(const QString &mod_path, const QString &error_message);
 
 private:
-	std::unique_ptr<mod_data> mod_data;
+	std::map<std::filesystem::path, mod_upload *> uploads; //the uploads, mapped to their mod directory paths; they are owned by the mod manager as their parent
+	std::deque<mod_upload *> queued_uploads; //prepared uploads waiting for a slot to make their Steam calls
+	int active_upload_count = 0; //the number of uploads making Steam calls
+	int max_concurrent_uploads = mod_manager::default_max_concurrent_uploads;
+	bool steam_wait_pending = false; //whether the queued uploads are waiting for Steam initialization to finish
 };
@@ -0,0 +1,230 @@
+#include "mod_manifest.h"
+
+#include "hash_util.h"
+#include "mod_file_filter.h"
+#include "util.h"
+
+#include <QtConcurrent>
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+std::filesystem::path mod_manifest::get_filepath(const std::filesystem::path &mod_path)
+{
+	const std::filesystem::path manifests_path = get_user_data_path() / "mod_manifests";
+
+	if (!std::filesystem::exists(manifests_path)) {
+		const bool success = std::filesystem::create_directories(manifests_path);
+		if (!success) {
+			throw std::runtime_error("Failed to create mod manifests path: \"" + manifests_path.string() + "\".");
+		}
+	}
+
+	//use a hash of the mod's path for the manifest filename, as with the staging directories
+	const std::string mod_path_str = to_string(std::filesystem::absolute(mod_path).lexically_normal());
+	std::filesystem::path filepath = manifests_path / (to_hex_string(hash_string(mod_path_str)) + ".txt");
+	filepath.make_preferred();
+	return filepath;
+}
+
+uint64_t mod_manifest::hash_file(const std::filesystem::path &filepath)
+{
+	std::ifstream ifstream(filepath, std::ios::binary);
+
+	if (!ifstream) {
+		throw std::runtime_error("Failed to open file \"" + to_string(filepath) + "\" for hashing.");
+	}
+
+	std::vector<char> buffer(mod_manifest::hash_chunk_size);
+	uint64_t hash = 0;
+
+	//hash each chunk with the previous chunk's hash as the seed
+	do {
+		ifstream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		hash = hash_data(buffer.data(), static_cast<size_t>(ifstream.gcount()), hash);
+	} while (ifstream);
+
+	if (ifstream.bad()) {
+		throw std::runtime_error("Failed to read file \"" + to_string(filepath) + "\" for hashing.");
+	}
+
+	return hash;
+}
+
+void mod_manifest::load(const std::filesystem::path &mod_path)
+{
+	this->mod_path = mod_path;
+	this->files.clear();
+
+	std::filesystem::path filepath = mod_manifest::get_filepath(mod_path);
+
+	if (!std::filesystem::exists(filepath)) {
+		//read the manifest from the mod's directory if it was written there by an earlier version, so that the mod's published state is kept; it is moved when saving
+		filepath = mod_path / mod_manifest::legacy_filename;
+
+		if (!std::filesystem::exists(filepath)) {
+			return;
+		}
+	}
+
+	std::ifstream ifstream(filepath);
+
+	if (!ifstream) {
+		throw std::runtime_error("Failed to open the mod manifest for reading.");
+	}
+
+	std::string line;
+
+	//the first line contains the state of the mod when it was last published
+	if (std::getline(ifstream, line)) {
+		std::istringstream line_stream(line);
+		std::string tag;
+		line_stream >> tag >> this->published_file_id >> std::hex >> this->published_content_hash >> this->published_title_hash >> this->published_preview_hash;
+
+		if (tag != "published" || !line_stream) {
+			//treat an invalid manifest as an empty one, so that it is rebuilt
+			log_error("The mod manifest \"" + to_string(filepath) + "\" is invalid.");
+			this->published_file_id = 0;
+			return;
+		}
+	}
+
+	while (std::getline(ifstream, line)) {
+		std::istringstream line_stream(line);
+		file_entry entry;
+		line_stream >> std::hex >> entry.hash >> std::dec >> entry.size >> entry.modified_time;
+
+		//the path is last, since it can contain spaces
+		std::string relative_path;
+		line_stream.get();
+		std::getline(line_stream, relative_path);
+
+		if (!relative_path.empty()) {
+			this->files[relative_path] = entry;
+		}
+	}
+
+	this->update_content_hash();
+}
+
+void mod_manifest::save() const
+{
+	const std::filesystem::path filepath = mod_manifest::get_filepath(this->mod_path);
+	std::filesystem::path temp_filepath = filepath;
+	temp_filepath += ".tmp";
+
+	{
+		std::ofstream ofstream(temp_filepath, std::ios::trunc);
+
+		if (!ofstream) {
+			throw std::runtime_error("Failed to open the mod manifest for writing.");
+		}
+
+		ofstream << "published " << this->published_file_id << std::hex << ' ' << this->published_content_hash << ' ' << this->published_title_hash << ' ' << this->published_preview_hash << '\n';
+
+		for (const auto &[relative_path, entry] : this->files) {
+			ofstream << std::hex << entry.hash << std::dec << ' ' << entry.size << ' ' << entry.modified_time << ' ' << relative_path << '\n';
+		}
+
+		if (!ofstream) {
+			throw std::runtime_error("Failed to write the mod manifest.");
+		}
+	}
+
+	//replace the manifest in one step, so that an interrupted write cannot leave it incomplete
+	std::filesystem::rename(temp_filepath, filepath);
+
+	std::error_code error_code;
+	std::filesystem::remove(this->mod_path / mod_manifest::legacy_filename, error_code);
+}
+
+void mod_manifest::update(const mod_file_filter &filter)
+{
+	struct file_to_hash final
+	{
+		std::filesystem::path filepath;
+		file_entry *entry = nullptr;
+		std::string error_message;
+	};
+
+	std::map<std::string, file_entry> files;
+	std::vector<file_to_hash> files_to_hash;
+
+	for (std::filesystem::recursive_directory_iterator dir_iterator(this->mod_path); dir_iterator != std::filesystem::recursive_directory_iterator(); ++dir_iterator) {
+		const std::filesystem::directory_entry &dir_entry = *dir_iterator;
+		const std::filesystem::path relative_path = dir_entry.path().lexically_relative(this->mod_path);
+
+		if (dir_entry.is_directory()) {
+			//don't go through excluded directories at all, as they can be large, e.g. version control directories
+			if (filter.is_excluded(relative_path)) {
+				dir_iterator.disable_recursion_pending();
+			}
+
+			continue;
+		}
+
+		if (!dir_entry.is_regular_file() || !filter.is_included(relative_path)) {
+			continue;
+		}
+
+		const std::string relative_path_str = to_generic_string(relative_path);
+
+		file_entry entry;
+		entry.size = dir_entry.file_size();
+		entry.modified_time = static_cast<int64_t>(dir_entry.last_write_time().time_since_epoch().count());
+
+		const auto find_iterator = this->files.find(relative_path_str);
+		if (find_iterator != this->files.end() && find_iterator->second.size == entry.size && find_iterator->second.modified_time == entry.modified_time) {
+			entry.hash = find_iterator->second.hash;
+		}
+
+		files[relative_path_str] = entry;
+	}
+
+	//the map's nodes are stable, so pointers to the entries can be given to the hashing tasks
+	for (auto &[relative_path, entry] : files) {
+		if (entry.hash == 0) {
+			file_to_hash file_to_hash;
+			file_to_hash.filepath = this->mod_path / std::filesystem::path(std::u8string(relative_path.begin(), relative_path.end()));
+			file_to_hash.entry = &entry;
+			files_to_hash.push_back(std::move(file_to_hash));
+		}
+	}
+
+	QtConcurrent::blockingMap(files_to_hash, [](file_to_hash &file_to_hash) {
+		try {
+			file_to_hash.entry->hash = mod_manifest::hash_file(file_to_hash.filepath);
+		} catch (const std::exception &exception) {
+			file_to_hash.error_message = exception.what();
+		}
+	});
+
+	for (const file_to_hash &file_to_hash : files_to_hash) {
+		if (!file_to_hash.error_message.empty()) {
+			throw std::runtime_error(file_to_hash.error_message);
+		}
+	}
+
+	this->files = std::move(files);
+	this->update_content_hash();
+}
+
+void mod_manifest::update_content_hash()
+{
+	this->content_hash = 0;
+	for (const auto &[relative_path, entry] : this->files) {
+		this->content_hash = hash_string(relative_path, this->content_hash);
+		this->content_hash = hash_data(&entry.hash, sizeof(entry.hash), this->content_hash);
+	}
+}
+
+uint64_t mod_manifest::get_file_hash(const std::filesystem::path &relative_path) const
+{
+	const auto find_iterator = this->files.find(to_generic_string(relative_path));
+	if (find_iterator == this->files.end()) {
+		return 0;
+	}
+
+	return find_iterator->second.hash;
+}
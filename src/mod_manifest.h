@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+
+class mod_file_filter;
+
+//manifest with the hashes of a mod's files, used to detect whether a mod has changed since it was last published
+//file hashes are cached by size and modification time, so that only the files which changed need to be hashed again
+//the manifest is kept in the user data directory rather than in the mod's directory, so that it is neither uploaded with the mod nor changes the directory's modification time
+class mod_manifest final
+{
+public:
+	static constexpr const char *legacy_filename = "mod_manifest.txt"; //the name of the manifest file in the mod's directory, where earlier versions kept it
+	static constexpr size_t hash_chunk_size = 1024 * 1024;
+
+	struct file_entry final
+	{
+		uintmax_t size = 0;
+		int64_t modified_time = 0;
+		uint64_t hash = 0;
+	};
+
+	static std::filesystem::path get_filepath(const std::filesystem::path &mod_path);
+	static uint64_t hash_file(const std::filesystem::path &filepath);
+
+	void load(const std::filesystem::path &mod_path);
+	void save() const;
+
+	//scan the mod's files which pass the filter, hashing those which are new or have changed, with the hashing being distributed over the global thread pool
+	void update(const mod_file_filter &filter);
+
+	const std::map<std::string, file_entry> &get_files() const
+	{
+		return this->files;
+	}
+
+	uint64_t get_content_hash() const
+	{
+		return this->content_hash;
+	}
+
+	//get the hash of a file in the mod, or 0 if the file is not in the manifest
+	uint64_t get_file_hash(const std::filesystem::path &relative_path) const;
+
+	bool is_content_published(const uint64_t published_file_id) const
+	{
+		return published_file_id == this->published_file_id && this->content_hash == this->published_content_hash;
+	}
+
+	bool is_title_published(const uint64_t published_file_id, const uint64_t title_hash) const
+	{
+		return published_file_id == this->published_file_id && title_hash == this->published_title_hash;
+	}
+
+	bool is_preview_published(const uint64_t published_file_id, const uint64_t preview_hash) const
+	{
+		return published_file_id == this->published_file_id && preview_hash == this->published_preview_hash;
+	}
+
+	void set_published(const uint64_t published_file_id, const uint64_t title_hash, const uint64_t preview_hash)
+	{
+		this->published_file_id = published_file_id;
+		this->published_content_hash = this->content_hash;
+		this->published_title_hash = title_hash;
+		this->published_preview_hash = preview_hash;
+	}
+
+private:
+	void update_content_hash();
+
+private:
+	std::filesystem::path mod_path;
+	std::map<std::string, file_entry> files; //file entries, mapped to their UTF-8 encoded paths relative to the mod directory
+	uint64_t content_hash = 0;
+	uint64_t published_file_id = 0;
+	uint64_t published_content_hash = 0;
+	uint64_t published_title_hash = 0;
+	uint64_t published_preview_hash = 0;
+};
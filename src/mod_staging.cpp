@@ -0,0 +1,162 @@
+#include "mod_staging.h"
+
+#include "hash_util.h"
+#include "mod_manifest.h"
+#include "util.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#include <set>
+#include <vector>
+
+static std::filesystem::path to_relative_path(const std::string &relative_path_str)
+{
+	return std::filesystem::path(std::u8string(relative_path_str.begin(), relative_path_str.end()));
+}
+
+std::filesystem::path mod_staging::get_staging_path(const std::filesystem::path &mod_path)
+{
+	//use a hash of the mod's path for the staging directory name, so that each mod has its own staging directory
+	const std::string mod_path_str = to_string(std::filesystem::absolute(mod_path).lexically_normal());
+	std::filesystem::path staging_path = get_user_data_path() / "workshop_staging" / to_hex_string(hash_string(mod_path_str));
+	staging_path.make_preferred();
+	return staging_path;
+}
+
+void mod_staging::update(const std::filesystem::path &mod_path, const mod_manifest &manifest)
+{
+	const std::filesystem::path staging_path = mod_staging::get_staging_path(mod_path);
+
+	if (std::filesystem::exists(staging_path)) {
+		mod_staging::remove_stale_entries(staging_path, manifest);
+	} else {
+		std::filesystem::create_directories(staging_path);
+	}
+
+	for (const auto &[relative_path_str, entry] : manifest.get_files()) {
+		const std::filesystem::path relative_path = to_relative_path(relative_path_str);
+		const std::filesystem::path source_filepath = mod_path / relative_path;
+		const std::filesystem::path staged_filepath = staging_path / relative_path;
+		const std::filesystem::file_time_type modified_time = std::filesystem::last_write_time(source_filepath);
+
+		if (mod_staging::is_staged(source_filepath, staged_filepath, entry.size, modified_time)) {
+			continue;
+		}
+
+		mod_staging::stage_file(source_filepath, staged_filepath, modified_time);
+	}
+}
+
+void mod_staging::remove_stale_entries(const std::filesystem::path &staging_path, const mod_manifest &manifest)
+{
+	std::set<std::filesystem::path> directories_to_keep;
+
+	for (const auto &[relative_path_str, entry] : manifest.get_files()) {
+		std::filesystem::path relative_path = to_relative_path(relative_path_str).parent_path();
+
+		while (!relative_path.empty()) {
+			directories_to_keep.insert(relative_path);
+			relative_path = relative_path.parent_path();
+		}
+	}
+
+	std::vector<std::filesystem::path> paths_to_remove;
+
+	for (std::filesystem::recursive_directory_iterator dir_iterator(staging_path); dir_iterator != std::filesystem::recursive_directory_iterator(); ++dir_iterator) {
+		const std::filesystem::path relative_path = dir_iterator->path().lexically_relative(staging_path);
+
+		if (dir_iterator->is_directory() && !dir_iterator->is_symlink()) {
+			if (!directories_to_keep.contains(relative_path)) {
+				paths_to_remove.push_back(dir_iterator->path());
+				dir_iterator.disable_recursion_pending();
+			}
+
+			continue;
+		}
+
+		if (!manifest.get_files().contains(to_generic_string(relative_path))) {
+			paths_to_remove.push_back(dir_iterator->path());
+		}
+	}
+
+	for (const std::filesystem::path &path : paths_to_remove) {
+		std::filesystem::remove_all(path);
+	}
+}
+
+bool mod_staging::is_staged(const std::filesystem::path &source_filepath, const std::filesystem::path &staged_filepath, const uintmax_t size, const std::filesystem::file_time_type modified_time)
+{
+	std::error_code error_code;
+
+	const std::filesystem::file_status staged_status = std::filesystem::symlink_status(staged_filepath, error_code);
+	if (error_code || !std::filesystem::is_regular_file(staged_status)) {
+		return false;
+	}
+
+	//a hard link is always up to date, as long as the source file has not been replaced by a different one
+	if (std::filesystem::equivalent(source_filepath, staged_filepath, error_code)) {
+		return true;
+	}
+
+	//for reflinks and copies, check whether the source file has changed since it was staged
+	return std::filesystem::file_size(staged_filepath, error_code) == size && !error_code && std::filesystem::last_write_time(staged_filepath, error_code) == modified_time && !error_code;
+}
+
+void mod_staging::stage_file(const std::filesystem::path &source_filepath, const std::filesystem::path &staged_filepath, const std::filesystem::file_time_type modified_time)
+{
+	std::filesystem::remove_all(staged_filepath);
+	std::filesystem::create_directories(staged_filepath.parent_path());
+
+	std::error_code error_code;
+	std::filesystem::create_hard_link(source_filepath, staged_filepath, error_code);
+
+	if (!error_code) {
+		return;
+	}
+
+	//hard links are not possible e.g. across file systems, or on file systems which don't support them
+	if (!mod_staging::create_reflink(source_filepath, staged_filepath)) {
+		std::filesystem::copy_file(source_filepath, staged_filepath, std::filesystem::copy_options::overwrite_existing);
+	}
+
+	//give the copy the same modification time as the source file, so that it can be recognized as up to date later on
+	std::filesystem::last_write_time(staged_filepath, modified_time);
+}
+
+bool mod_staging::create_reflink(const std::filesystem::path &source_filepath, const std::filesystem::path &staged_filepath)
+{
+#ifdef FICLONE
+	const int source_fd = open(source_filepath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (source_fd == -1) {
+		return false;
+	}
+
+	const int staged_fd = open(staged_filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (staged_fd == -1) {
+		close(source_fd);
+		return false;
+	}
+
+	const bool success = ioctl(staged_fd, FICLONE, source_fd) == 0;
+
+	close(staged_fd);
+	close(source_fd);
+
+	if (!success) {
+		std::error_code error_code;
+		std::filesystem::remove(staged_filepath, error_code);
+	}
+
+	return success;
+#else
+	Q_UNUSED(source_filepath)
+	Q_UNUSED(staged_filepath)
+
+	return false;
+#endif
+}
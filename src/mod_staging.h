@@ -0,0 +1,23 @@
+#pragma once
+
+#include <filesystem>
+
+class mod_manifest;
+
+//staging directory with a filtered mirror of a mod, which is what gets uploaded to the Workshop
+//files are hard links to the mod's files where possible, falling back to reflinks and then to copies, so that staging costs little disk space
+//the staging directory is kept between uploads, with only the entries which changed being updated
+class mod_staging final
+{
+public:
+	static std::filesystem::path get_staging_path(const std::filesystem::path &mod_path);
+
+	//update the staging directory to mirror the files in the manifest
+	static void update(const std::filesystem::path &mod_path, const mod_manifest &manifest);
+
+private:
+	static void remove_stale_entries(const std::filesystem::path &staging_path, const mod_manifest &manifest);
+	static void stage_file(const std::filesystem::path &source_filepath, const std::filesystem::path &staged_filepath, const std::filesystem::file_time_type modified_time);
+	static bool is_staged(const std::filesystem::path &source_filepath, const std::filesystem::path &staged_filepath, const uintmax_t size, const std::filesystem::file_time_type modified_time);
+	static bool create_reflink(const std::filesystem::path &source_filepath, const std::filesystem::path &staged_filepath);
+};
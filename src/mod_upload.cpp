@@ -0,0 +1,135 @@
+#include "mod_upload.h"
+
+#include "steam_backend.h"
+#include "trace.h"
+#include "util.h"
+
+#include <QMetaEnum>
+#include <QTimer>
+
+mod_upload::mod_upload(const std::filesystem::path &mod_path, QObject *parent) : QObject(parent)
+{
+	this->mod_data = std::make_shared<::mod_data>();
+	this->mod_data->path = mod_path;
+
+	if (trace_recorder::is_enabled()) {
+		this->trace_id = trace_recorder::generate_async_id();
+		this->state_start_time = trace_recorder::clock::now();
+	}
+}
+
+QString mod_upload::get_mod_path() const
+{
+	return to_qstring(this->mod_data->path);
+}
+
+void mod_upload::set_state(const upload_state state)
+{
+	if (state == this->state) {
+		return;
+	}
+
+	if (this->trace_id != 0) {
+		//trace each stage of the upload, with the key of the state's enum value as the event name
+		const trace_recorder::clock::time_point now = trace_recorder::clock::now();
+		std::string args;
+		trace_recorder::append_arg(args, "mod", to_generic_string(this->mod_data->path));
+		trace_recorder::add_async_event(QMetaEnum::fromType<upload_state>().valueToKey(static_cast<int>(this->state)), "upload", this->trace_id, this->state_start_time, now, std::move(args));
+		this->state_start_time = now;
+	}
+
+	this->state = state;
+	emit stateChanged();
+}
+
+void mod_upload::start_progress_tracking(const UGCUpdateHandle_t update_handle)
+{
+	if (this->is_finished()) {
+		return;
+	}
+
+	this->stop_progress_tracking();
+
+	this->update_handle = update_handle;
+	this->previous_progress_time = std::chrono::steady_clock::now();
+
+	this->progress_timer = new QTimer(this);
+	connect(this->progress_timer, &QTimer::timeout, this, &mod_upload::update_progress);
+	this->progress_timer->start(mod_upload::progress_interval_ms);
+}
+
+void mod_upload::stop_progress_tracking()
+{
+	if (this->progress_timer == nullptr) {
+		return;
+	}
+
+	this->progress_timer->stop();
+	this->progress_timer->deleteLater();
+	this->progress_timer = nullptr;
+	this->update_handle = k_UGCUpdateHandleInvalid;
+}
+
+void mod_upload::update_progress()
+{
+	if (this->is_finished()) {
+		this->stop_progress_tracking();
+		return;
+	}
+
+	uint64 bytes_processed = 0;
+	uint64 bytes_total = 0;
+	const EItemUpdateStatus status = steam_backend::get()->get_item_update_progress(this->update_handle, &bytes_processed, &bytes_total);
+
+	if (status == k_EItemUpdateStatusInvalid) {
+		return;
+	}
+
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	const double elapsed_seconds = std::chrono::duration<double>(now - this->previous_progress_time).count();
+
+	if (bytes_total == this->bytes_total && bytes_processed >= this->bytes_processed && elapsed_seconds > 0) {
+		//smooth the throughput, as the progress reported by Steam advances in bursts
+		static constexpr double smoothing_factor = 0.3;
+		const double current_throughput = static_cast<double>(bytes_processed - this->bytes_processed) / elapsed_seconds;
+		this->throughput = this->throughput == 0 ? current_throughput : (smoothing_factor * current_throughput + (1 - smoothing_factor) * this->throughput);
+	} else {
+		//the total changes when Steam moves on to another stage of the upload, e.g. from the content to the preview image
+		this->throughput = 0;
+	}
+
+	this->bytes_processed = bytes_processed;
+	this->bytes_total = bytes_total;
+	this->previous_progress_time = now;
+
+	if (this->throughput > 0 && bytes_total >= bytes_processed) {
+		this->eta = static_cast<int>(static_cast<double>(bytes_total - bytes_processed) / this->throughput);
+	} else {
+		this->eta = -1;
+	}
+
+	emit progressChanged();
+}
+
+void mod_upload::complete()
+{
+	this->stop_progress_tracking();
+
+	if (this->bytes_total > 0) {
+		this->bytes_processed = this->bytes_total;
+	}
+	this->eta = 0;
+	emit progressChanged();
+
+	this->set_state(upload_state::done);
+	emit completed();
+}
+
+void mod_upload::fail(const QString &error_message)
+{
+	this->stop_progress_tracking();
+
+	this->error_message = error_message;
+	this->set_state(upload_state::failed);
+	emit failed(error_message);
+}
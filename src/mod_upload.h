@@ -0,0 +1,167 @@
+#pragma once
+
+#include "mod_file_filter.h"
+#include "mod_manifest.h"
+
+#include "steam/isteamugc.h"
+
+#include <QObject>
+#include <QString>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+
+class QTimer;
+
+struct mod_data final
+{
+	std::filesystem::path path;
+	std::string name;
+	uint64_t published_file_id = 0;
+	std::filesystem::path image_filepath;
+	uint64_t preview_hash = 0;
+	std::filesystem::path preview_filepath; //the optimized preview image to upload
+	mod_file_filter file_filter;
+	mod_manifest manifest;
+	std::filesystem::path content_path; //the staging directory with the files to upload
+
+	std::filesystem::path get_mod_filepath() const
+	{
+		return this->path / "module.txt";
+	}
+
+	std::filesystem::path get_mod_id_filepath() const
+	{
+		return this->path / "mod_id.txt";
+	}
+
+	std::filesystem::path find_image_filepath() const
+	{
+		std::filesystem::path filepath = this->path / "module.png";
+		if (std::filesystem::exists(filepath)) {
+			return filepath;
+		}
+
+		filepath.replace_extension(".jpg");
+		if (std::filesystem::exists(filepath)) {
+			return filepath;
+		}
+
+		filepath.replace_extension(".jpeg");
+		if (std::filesystem::exists(filepath)) {
+			return filepath;
+		}
+
+		filepath.replace_extension(".gif");
+		if (std::filesystem::exists(filepath)) {
+			return filepath;
+		}
+
+		return std::filesystem::path();
+	}
+};
+
+//a mod upload, which can be followed from QML
+class mod_upload final : public QObject
+{
+	Q_OBJECT
+
+	Q_PROPERTY(QString mod_path READ get_mod_path CONSTANT)
+	Q_PROPERTY(upload_state state READ get_state NOTIFY stateChanged)
+	Q_PROPERTY(bool finished READ is_finished NOTIFY stateChanged)
+	Q_PROPERTY(QString error_message READ get_error_message NOTIFY stateChanged)
+	Q_PROPERTY(quint64 bytes_processed READ get_bytes_processed NOTIFY progressChanged)
+	Q_PROPERTY(quint64 bytes_total READ get_bytes_total NOTIFY progressChanged)
+	Q_PROPERTY(double throughput READ get_throughput NOTIFY progressChanged)
+	Q_PROPERTY(int eta READ get_eta NOTIFY progressChanged)
+
+public:
+	enum class upload_state {
+		preparing, //the mod's files are being read
+		queued, //waiting for other uploads to finish
+		creating, //the Workshop item is being created
+		updating, //the Workshop item's content is being uploaded
+		done,
+		failed
+	};
+	Q_ENUM(upload_state)
+
+	static constexpr int progress_interval_ms = 250;
+
+	explicit mod_upload(const std::filesystem::path &mod_path, QObject *parent);
+
+	const std::shared_ptr<::mod_data> &get_mod_data() const
+	{
+		return this->mod_data;
+	}
+
+	QString get_mod_path() const;
+
+	upload_state get_state() const
+	{
+		return this->state;
+	}
+
+	void set_state(const upload_state state);
+
+	bool is_finished() const
+	{
+		return this->state == upload_state::done || this->state == upload_state::failed;
+	}
+
+	const QString &get_error_message() const
+	{
+		return this->error_message;
+	}
+
+	quint64 get_bytes_processed() const
+	{
+		return this->bytes_processed;
+	}
+
+	quint64 get_bytes_total() const
+	{
+		return this->bytes_total;
+	}
+
+	//get the upload speed, in bytes per second
+	double get_throughput() const
+	{
+		return this->throughput;
+	}
+
+	//get the estimated remaining time for the upload, in seconds, or -1 if it is not known
+	int get_eta() const
+	{
+		return this->eta;
+	}
+
+	void start_progress_tracking(const UGCUpdateHandle_t update_handle);
+	void complete();
+	void fail(const QString &error_message);
+
+signals:
+	void stateChanged();
+	void progressChanged();
+	void completed();
+	void failed(const QString &error_message);
+
+private:
+	void update_progress();
+	void stop_progress_tracking();
+
+private:
+	std::shared_ptr<::mod_data> mod_data; //shared with the worker thread preparing the upload
+	upload_state state = upload_state::preparing;
+	QString error_message;
+	UGCUpdateHandle_t update_handle = k_UGCUpdateHandleInvalid;
+	QTimer *progress_timer = nullptr;
+	quint64 bytes_processed = 0;
+	quint64 bytes_total = 0;
+	double throughput = 0;
+	int eta = -1;
+	std::chrono::steady_clock::time_point previous_progress_time;
+	uint64_t trace_id = 0; //the ID for tracing the stages of the upload, or 0 if tracing was not enabled when the upload started
+	std::chrono::steady_clock::time_point state_start_time;
+};
@@ -0,0 +1,490 @@
+#include "mod_validator.h"
+
+#include "hash_util.h"
+#include "mod_upload.h"
+#include "util.h"
+
+#include <QImageReader>
+#include <QSettings>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string_view>
+
+static constexpr std::array<std::string_view, 22> reserved_filenames = {
+	"con", "prn", "aux", "nul",
+	"com1", "com2", "com3", "com4", "com5", "com6", "com7", "com8", "com9",
+	"lpt1", "lpt2", "lpt3", "lpt4", "lpt5", "lpt6", "lpt7", "lpt8", "lpt9"
+};
+
+//incremental UTF-8 validator, so that files can be checked in chunks; it rejects overlong encodings, surrogates and code points beyond U+10FFFF
+class utf8_validator final
+{
+public:
+	bool feed(const unsigned char *data, const size_t size)
+	{
+		for (size_t i = 0; i < size; ++i) {
+			const unsigned char c = data[i];
+
+			if (this->pending_count == 0) {
+				if (c < 0x80) {
+					continue;
+				}
+
+				this->lower_bound = 0x80;
+				this->upper_bound = 0xBF;
+
+				if (c >= 0xC2 && c <= 0xDF) {
+					this->pending_count = 1;
+				} else if (c >= 0xE0 && c <= 0xEF) {
+					this->pending_count = 2;
+
+					if (c == 0xE0) {
+						this->lower_bound = 0xA0;
+					} else if (c == 0xED) {
+						this->upper_bound = 0x9F;
+					}
+				} else if (c >= 0xF0 && c <= 0xF4) {
+					this->pending_count = 3;
+
+					if (c == 0xF0) {
+						this->lower_bound = 0x90;
+					} else if (c == 0xF4) {
+						this->upper_bound = 0x8F;
+					}
+				} else {
+					return false;
+				}
+
+				continue;
+			}
+
+			if (c < this->lower_bound || c > this->upper_bound) {
+				return false;
+			}
+
+			//only the first continuation byte has narrower bounds
+			this->lower_bound = 0x80;
+			this->upper_bound = 0xBF;
+			--this->pending_count;
+		}
+
+		return true;
+	}
+
+	bool is_complete() const
+	{
+		return this->pending_count == 0;
+	}
+
+private:
+	int pending_count = 0; //the number of continuation bytes still expected for the current code point
+	unsigned char lower_bound = 0x80;
+	unsigned char upper_bound = 0xBF;
+};
+
+static bool is_valid_utf8(const std::string_view str)
+{
+	utf8_validator validator;
+	return validator.feed(reinterpret_cast<const unsigned char *>(str.data()), str.size()) && validator.is_complete();
+}
+
+mod_validator::result mod_validator::validate(const mod_data &mod_data)
+{
+	struct file_to_check final
+	{
+		std::filesystem::path filepath;
+		cache_entry *entry = nullptr;
+	};
+
+	result validation_result;
+	std::vector<problem> &problems = validation_result.problems;
+
+	mod_validator::check_module_file(mod_data, problems);
+
+	const std::map<std::string, cache_entry> previous_cache = mod_validator::load_cache(mod_data.path);
+	std::map<std::string, cache_entry> cache;
+	std::set<QString> lowercase_paths;
+	const std::filesystem::path canonical_root_path = std::filesystem::weakly_canonical(mod_data.path);
+
+	for (std::filesystem::recursive_directory_iterator dir_iterator(mod_data.path); dir_iterator != std::filesystem::recursive_directory_iterator(); ++dir_iterator) {
+		const std::filesystem::directory_entry &dir_entry = *dir_iterator;
+		const std::filesystem::path relative_path = dir_entry.path().lexically_relative(mod_data.path);
+
+		//check directories with the same filter as the manifest, so that only what would be uploaded is checked
+		if (dir_entry.is_directory()) {
+			if (mod_data.file_filter.is_excluded(relative_path)) {
+				dir_iterator.disable_recursion_pending();
+				continue;
+			}
+		} else if (!mod_data.file_filter.is_included(relative_path)) {
+			continue;
+		}
+
+		const std::string relative_path_str = to_generic_string(relative_path);
+
+		mod_validator::check_path(relative_path_str, problems);
+
+		if (dir_entry.is_symlink()) {
+			mod_validator::check_symlink(canonical_root_path, dir_entry, relative_path_str, problems);
+		}
+
+		//files whose paths differ only in case would overwrite each other on case-insensitive file systems
+		if (!lowercase_paths.insert(QString::fromStdString(relative_path_str).toLower()).second) {
+			problems.push_back({ relative_path_str, "The path differs only in case from that of another file." });
+		}
+
+		if (dir_entry.is_directory() || !dir_entry.is_regular_file()) {
+			continue;
+		}
+
+		++validation_result.file_count;
+
+		const uintmax_t file_size = dir_entry.file_size();
+		validation_result.total_size += file_size;
+
+		if (file_size > mod_validator::max_file_size) {
+			problems.push_back({ relative_path_str, "The file is larger than " + std::to_string(mod_validator::max_file_size / 1024 / 1024) + " MB." });
+		}
+
+		if (mod_validator::is_content_checked(relative_path)) {
+			cache_entry entry;
+			entry.size = file_size;
+			entry.modified_time = static_cast<int64_t>(dir_entry.last_write_time().time_since_epoch().count());
+			cache[relative_path_str] = entry;
+		}
+	}
+
+	if (validation_result.file_count > mod_validator::max_file_count) {
+		problems.push_back({ std::string(), "The mod has " + std::to_string(validation_result.file_count) + " files, more than the limit of " + std::to_string(mod_validator::max_file_count) + "." });
+	}
+
+	if (validation_result.total_size > mod_validator::max_total_size) {
+		problems.push_back({ std::string(), "The mod's files take up " + std::to_string(validation_result.total_size / 1024 / 1024) + " MB, more than the limit of " + std::to_string(mod_validator::max_total_size / 1024 / 1024) + " MB." });
+	}
+
+	//check the contents of the files which are new or have changed, reusing the cached verdicts for the others
+	std::vector<file_to_check> files_to_check;
+
+	for (auto &[relative_path_str, entry] : cache) {
+		const auto find_iterator = previous_cache.find(relative_path_str);
+
+		if (find_iterator != previous_cache.end() && find_iterator->second.size == entry.size && find_iterator->second.modified_time == entry.modified_time) {
+			entry.verdict = find_iterator->second.verdict;
+			continue;
+		}
+
+		file_to_check file_to_check;
+		file_to_check.filepath = mod_data.path / std::filesystem::path(std::u8string(relative_path_str.begin(), relative_path_str.end()));
+		file_to_check.entry = &entry;
+		files_to_check.push_back(std::move(file_to_check));
+	}
+
+	QtConcurrent::blockingMap(files_to_check, [](file_to_check &file_to_check) {
+		try {
+			file_to_check.entry->verdict = mod_validator::check_content(file_to_check.filepath);
+		} catch (const std::exception &exception) {
+			report_exception(exception);
+			file_to_check.entry->verdict = file_verdict::unreadable;
+		}
+	});
+
+	for (const auto &[relative_path_str, entry] : cache) {
+		if (entry.verdict == file_verdict::invalid_encoding) {
+			problems.push_back({ relative_path_str, "The file is not valid UTF-8 text." });
+		} else if (entry.verdict == file_verdict::unreadable) {
+			problems.push_back({ relative_path_str, "The file could not be read." });
+		}
+	}
+
+	mod_validator::check_preview(mod_data, problems);
+
+	if (!files_to_check.empty() || cache.size() != previous_cache.size()) {
+		try {
+			mod_validator::save_cache(mod_data.path, cache);
+		} catch (const std::exception &exception) {
+			//the cache only speeds up later validations, so failing to save it is not a problem for the mod
+			report_exception(exception);
+		}
+	}
+
+	return validation_result;
+}
+
+std::string mod_validator::describe_problems(const std::vector<problem> &problems)
+{
+	std::string description = "The mod has " + std::to_string(problems.size()) + (problems.size() == 1 ? " problem:" : " problems:");
+
+	for (const problem &problem : problems) {
+		description += "\n";
+
+		if (!problem.relative_path.empty()) {
+			description += "\"" + problem.relative_path + "\": ";
+		}
+
+		description += problem.message;
+	}
+
+	return description;
+}
+
+void mod_validator::check_module_file(const mod_data &mod_data, std::vector<problem> &problems)
+{
+	const std::filesystem::path mod_filepath = mod_data.get_mod_filepath();
+	static const std::string module_filename = "module.txt";
+
+	if (!std::filesystem::exists(mod_filepath)) {
+		problems.push_back({ module_filename, "The file is missing." });
+		return;
+	}
+
+	const QSettings mod_info(to_qstring(mod_filepath), QSettings::IniFormat);
+
+	if (mod_info.status() != QSettings::NoError) {
+		problems.push_back({ module_filename, "The file could not be parsed." });
+		return;
+	}
+
+	if (mod_data.name.empty()) {
+		problems.push_back({ module_filename, "The \"name\" key is missing or empty." });
+	} else if (mod_data.name.size() >= k_cchPublishedDocumentTitleMax) {
+		problems.push_back({ module_filename, "The name is longer than the Workshop's limit of " + std::to_string(k_cchPublishedDocumentTitleMax - 1) + " bytes." });
+	} else if (mod_data.name.find_first_of("\r\n") != std::string::npos) {
+		problems.push_back({ module_filename, "The name contains line breaks." });
+	}
+
+	for (const char *key : { "upload_include", "upload_exclude" }) {
+		if (!mod_info.contains(key)) {
+			continue;
+		}
+
+		for (const QString &pattern : mod_info.value(key).toStringList()) {
+			if (pattern.trimmed().isEmpty()) {
+				problems.push_back({ module_filename, "The \"" + std::string(key) + "\" key contains an empty pattern." });
+				break;
+			}
+		}
+	}
+}
+
+void mod_validator::check_path(const std::string &relative_path_str, std::vector<problem> &problems)
+{
+	if (relative_path_str.size() > mod_validator::max_relative_path_length) {
+		problems.push_back({ relative_path_str, "The path is longer than " + std::to_string(mod_validator::max_relative_path_length) + " bytes." });
+	}
+
+	if (!is_valid_utf8(relative_path_str)) {
+		problems.push_back({ relative_path_str, "The path is not valid UTF-8." });
+		return;
+	}
+
+	//the mod must be usable on all platforms, so the path must be valid on Windows as well
+	for (const std::string &component : split_string(relative_path_str, '/')) {
+		if (component.empty()) {
+			continue;
+		}
+
+		const bool has_invalid_character = std::any_of(component.begin(), component.end(), [](const char c) {
+			return static_cast<unsigned char>(c) < 0x20 || std::string_view("<>:\"\\|?*").find(c) != std::string_view::npos;
+		});
+
+		if (has_invalid_character) {
+			problems.push_back({ relative_path_str, "The path contains characters which are invalid on Windows." });
+			return;
+		}
+
+		if (component.back() == '.' || component.back() == ' ') {
+			problems.push_back({ relative_path_str, "A component of the path ends with a dot or a space, which is invalid on Windows." });
+			return;
+		}
+
+		std::string stem = component.substr(0, component.find('.'));
+		std::transform(stem.begin(), stem.end(), stem.begin(), [](const unsigned char c) {
+			return static_cast<char>(std::tolower(c));
+		});
+
+		if (std::find(reserved_filenames.begin(), reserved_filenames.end(), stem) != reserved_filenames.end()) {
+			problems.push_back({ relative_path_str, "The path contains a name reserved by Windows." });
+			return;
+		}
+	}
+}
+
+void mod_validator::check_symlink(const std::filesystem::path &root_path, const std::filesystem::directory_entry &dir_entry, const std::string &relative_path_str, std::vector<problem> &problems)
+{
+	std::error_code error_code;
+	const std::filesystem::path target_path = std::filesystem::weakly_canonical(dir_entry.path(), error_code);
+
+	if (error_code) {
+		problems.push_back({ relative_path_str, "The symbolic link could not be resolved." });
+		return;
+	}
+
+	const std::filesystem::path relative_target_path = target_path.lexically_relative(root_path);
+
+	if (relative_target_path.empty() || *relative_target_path.begin() == "..") {
+		problems.push_back({ relative_path_str, "The symbolic link points outside of the mod directory." });
+	}
+}
+
+void mod_validator::check_preview(const mod_data &mod_data, std::vector<problem> &problems)
+{
+	if (mod_data.image_filepath.empty()) {
+		return;
+	}
+
+	const std::string relative_path_str = to_generic_string(mod_data.image_filepath.lexically_relative(mod_data.path));
+
+	//read only the image's header for its dimensions, without decoding it
+	QImageReader image_reader(to_qstring(mod_data.image_filepath));
+	const QSize size = image_reader.size();
+
+	if (!size.isValid()) {
+		problems.push_back({ relative_path_str, "The preview image could not be read: " + image_reader.errorString().toStdString() });
+		return;
+	}
+
+	if (size.width() < mod_validator::min_preview_dimension || size.height() < mod_validator::min_preview_dimension) {
+		problems.push_back({ relative_path_str, "The preview image is smaller than " + std::to_string(mod_validator::min_preview_dimension) + "x" + std::to_string(mod_validator::min_preview_dimension) + " pixels." });
+	} else if (size.width() > mod_validator::max_preview_dimension || size.height() > mod_validator::max_preview_dimension) {
+		problems.push_back({ relative_path_str, "The preview image is larger than " + std::to_string(mod_validator::max_preview_dimension) + "x" + std::to_string(mod_validator::max_preview_dimension) + " pixels." });
+	}
+}
+
+mod_validator::file_verdict mod_validator::check_content(const std::filesystem::path &filepath)
+{
+	std::ifstream ifstream(filepath, std::ios::binary);
+
+	if (!ifstream) {
+		throw std::runtime_error("Failed to open file \"" + to_string(filepath) + "\" for validation.");
+	}
+
+	std::vector<char> buffer(mod_validator::content_check_chunk_size);
+	utf8_validator validator;
+
+	do {
+		ifstream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+		if (!validator.feed(reinterpret_cast<const unsigned char *>(buffer.data()), static_cast<size_t>(ifstream.gcount()))) {
+			return file_verdict::invalid_encoding;
+		}
+	} while (ifstream);
+
+	if (ifstream.bad()) {
+		throw std::runtime_error("Failed to read file \"" + to_string(filepath) + "\" for validation.");
+	}
+
+	return validator.is_complete() ? file_verdict::valid : file_verdict::invalid_encoding;
+}
+
+bool mod_validator::is_content_checked(const std::filesystem::path &relative_path)
+{
+	//the game reads these files as UTF-8 text
+	const std::filesystem::path extension = relative_path.extension();
+	return extension == ".txt" || extension == ".lua";
+}
+
+std::filesystem::path mod_validator::get_cache_filepath(const std::filesystem::path &mod_path)
+{
+	const std::filesystem::path cache_path = get_user_data_path() / "mod_validation";
+
+	if (!std::filesystem::exists(cache_path)) {
+		const bool success = std::filesystem::create_directories(cache_path);
+		if (!success) {
+			throw std::runtime_error("Failed to create mod validation cache path: \"" + cache_path.string() + "\".");
+		}
+	}
+
+	//use a hash of the mod's path for the cache filename, as with the staging directories
+	const std::string mod_path_str = to_string(std::filesystem::absolute(mod_path).lexically_normal());
+	std::filesystem::path filepath = cache_path / (to_hex_string(hash_string(mod_path_str)) + ".txt");
+	filepath.make_preferred();
+	return filepath;
+}
+
+std::map<std::string, mod_validator::cache_entry> mod_validator::load_cache(const std::filesystem::path &mod_path)
+{
+	std::map<std::string, cache_entry> cache;
+
+	std::filesystem::path filepath;
+
+	try {
+		filepath = mod_validator::get_cache_filepath(mod_path);
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+		return cache;
+	}
+
+	if (!std::filesystem::exists(filepath)) {
+		return cache;
+	}
+
+	std::ifstream ifstream(filepath);
+
+	if (!ifstream) {
+		log_error("Failed to open the mod validation cache \"" + to_string(filepath) + "\" for reading.");
+		return cache;
+	}
+
+	std::string line;
+	while (std::getline(ifstream, line)) {
+		std::istringstream line_stream(line);
+		cache_entry entry;
+		int verdict = 0;
+		line_stream >> entry.size >> entry.modified_time >> verdict;
+
+		//the path is last, since it can contain spaces
+		std::string relative_path;
+		line_stream.get();
+		std::getline(line_stream, relative_path);
+
+		if (!line_stream || relative_path.empty() || verdict < 0 || verdict > static_cast<int>(file_verdict::invalid_encoding)) {
+			//an invalid cache only means that the files are checked again
+			return std::map<std::string, cache_entry>();
+		}
+
+		entry.verdict = static_cast<file_verdict>(verdict);
+		cache[relative_path] = entry;
+	}
+
+	return cache;
+}
+
+void mod_validator::save_cache(const std::filesystem::path &mod_path, const std::map<std::string, cache_entry> &cache)
+{
+	const std::filesystem::path filepath = mod_validator::get_cache_filepath(mod_path);
+	std::filesystem::path temp_filepath = filepath;
+	temp_filepath += ".tmp";
+
+	{
+		std::ofstream ofstream(temp_filepath, std::ios::trunc);
+
+		if (!ofstream) {
+			throw std::runtime_error("Failed to open the mod validation cache for writing.");
+		}
+
+		for (const auto &[relative_path, entry] : cache) {
+			if (entry.verdict == file_verdict::unreadable) {
+				continue;
+			}
+
+			ofstream << entry.size << ' ' << entry.modified_time << ' ' << static_cast<int>(entry.verdict) << ' ' << relative_path << '\n';
+		}
+
+		if (!ofstream) {
+			throw std::runtime_error("Failed to write the mod validation cache.");
+		}
+	}
+
+	//replace the cache in one step, so that an interrupted write cannot leave it incomplete
+	std::filesystem::rename(temp_filepath, filepath);
+
+	//remove the cache file written into the mod's directory by earlier versions
+	std::error_code error_code;
+	std::filesystem::remove(mod_path / mod_validator::legacy_cache_filename, error_code);
+}
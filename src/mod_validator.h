@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+struct mod_data;
+
+//checks a mod for problems before anything is sent to Steam, so that a malformed mod fails in seconds instead of after a round trip to the Workshop, with all of its problems being reported at once
+//the verdicts for the files' contents are cached by size and modification time, so that validating an unchanged mod does not need to read its files again
+//the cache is kept in the user data directory rather than in the mod's directory, so that it is neither uploaded with the mod nor changes the directory's modification time
+class mod_validator final
+{
+public:
+	static constexpr const char *legacy_cache_filename = "mod_validation.txt"; //the name of the cache file in the mod's directory, where earlier versions kept it
+	static constexpr size_t max_file_count = 20000;
+	static constexpr uintmax_t max_file_size = 512 * 1024 * 1024;
+	static constexpr uintmax_t max_total_size = 2048ULL * 1024 * 1024;
+	static constexpr size_t max_relative_path_length = 160; //kept well below the Windows path length limit, since the Workshop content is placed in a deeply nested directory
+	static constexpr int min_preview_dimension = 64;
+	static constexpr int max_preview_dimension = 8192; //larger images would take too long to optimize
+	static constexpr size_t content_check_chunk_size = 1024 * 1024;
+
+	struct problem final
+	{
+		std::string relative_path; //the path of the file with the problem, or empty if it concerns the mod as a whole
+		std::string message;
+	};
+
+	struct result final
+	{
+		std::vector<problem> problems;
+		size_t file_count = 0;
+		uintmax_t total_size = 0;
+	};
+
+	//validate a mod whose module.txt has been parsed; this may be called from a worker thread, and the content checks are distributed over the global thread pool
+	static result validate(const mod_data &mod_data);
+
+	static std::string describe_problems(const std::vector<problem> &problems);
+
+private:
+	enum class file_verdict {
+		valid,
+		invalid_encoding,
+		unreadable //not cached, so that the file is checked again on the next validation
+	};
+
+	struct cache_entry final
+	{
+		uintmax_t size = 0;
+		int64_t modified_time = 0;
+		file_verdict verdict = file_verdict::valid;
+	};
+
+	static void check_module_file(const mod_data &mod_data, std::vector<problem> &problems);
+	static void check_path(const std::string &relative_path_str, std::vector<problem> &problems);
+	static void check_symlink(const std::filesystem::path &root_path, const std::filesystem::directory_entry &dir_entry, const std::string &relative_path_str, std::vector<problem> &problems);
+	static void check_preview(const mod_data &mod_data, std::vector<problem> &problems);
+	static file_verdict check_content(const std::filesystem::path &filepath);
+	static bool is_content_checked(const std::filesystem::path &relative_path);
+
+	static std::filesystem::path get_cache_filepath(const std::filesystem::path &mod_path);
+	static std::map<std::string, cache_entry> load_cache(const std::filesystem::path &mod_path);
+	static void save_cache(const std::filesystem::path &mod_path, const std::map<std::string, cache_entry> &cache);
+};
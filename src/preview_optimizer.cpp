@@ -0,0 +1,128 @@
+#include "preview_optimizer.h"
+
+#include "hash_util.h"
+#include "util.h"
+
+#include <QImage>
+#include <QImageReader>
+
+std::filesystem::path preview_optimizer::get_cache_path()
+{
+	const std::filesystem::path path = get_user_data_path() / "preview_cache";
+
+	if (!std::filesystem::exists(path)) {
+		const bool success = std::filesystem::create_directories(path);
+		if (!success) {
+			throw std::runtime_error("Failed to create preview cache path: \"" + path.string() + "\".");
+		}
+	}
+
+	return path;
+}
+
+std::filesystem::path preview_optimizer::optimize(const std::filesystem::path &image_filepath, const uint64_t image_hash)
+{
+	if (preview_optimizer::is_within_budget(image_filepath)) {
+		return image_filepath;
+	}
+
+	//the cache key consists of a key for the source image's path, and one for its modification time and contents
+	const std::string source_key = to_hex_string(hash_string(to_string(std::filesystem::absolute(image_filepath).lexically_normal())));
+	const int64_t modified_time = static_cast<int64_t>(std::filesystem::last_write_time(image_filepath).time_since_epoch().count());
+	const uint64_t version_hash = hash_data(&modified_time, sizeof(modified_time), image_hash);
+	const std::string cache_key = source_key + "_" + to_hex_string(version_hash);
+
+	const std::filesystem::path cache_path = preview_optimizer::get_cache_path();
+
+	for (const char *extension : { ".jpg", ".png" }) {
+		const std::filesystem::path cached_filepath = cache_path / (cache_key + extension);
+
+		if (std::filesystem::exists(cached_filepath)) {
+			return cached_filepath;
+		}
+	}
+
+	QImageReader image_reader(to_qstring(image_filepath));
+	image_reader.setAutoTransform(true);
+
+	QImage image = image_reader.read();
+	if (image.isNull()) {
+		throw std::runtime_error("Failed to read preview image \"" + to_string(image_filepath) + "\": " + image_reader.errorString().toStdString());
+	}
+
+	if (image.width() > preview_optimizer::max_dimension || image.height() > preview_optimizer::max_dimension) {
+		image = image.scaled(preview_optimizer::max_dimension, preview_optimizer::max_dimension, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+	}
+
+	//keep images with transparency lossless, since JPEG does not support transparency
+	const bool lossless = image.hasAlphaChannel();
+
+	preview_optimizer::remove_stale_entries(cache_path, source_key);
+
+	const std::filesystem::path output_filepath = cache_path / (cache_key + (lossless ? ".png" : ".jpg"));
+
+	//write to a temporary file first, so that an interrupted write cannot leave an incomplete image in the cache
+	std::filesystem::path temp_filepath = output_filepath;
+	temp_filepath += ".tmp";
+	preview_optimizer::encode(image, temp_filepath, lossless);
+	std::filesystem::rename(temp_filepath, output_filepath);
+
+	if (std::filesystem::file_size(output_filepath) > preview_optimizer::max_file_size) {
+		log_error("The optimized preview image for \"" + to_string(image_filepath) + "\" still exceeds the size limit.");
+	}
+
+	return output_filepath;
+}
+
+bool preview_optimizer::is_within_budget(const std::filesystem::path &image_filepath)
+{
+	if (std::filesystem::file_size(image_filepath) > preview_optimizer::max_file_size) {
+		return false;
+	}
+
+	//read only the image's header for its dimensions, without decoding it
+	const QSize size = QImageReader(to_qstring(image_filepath)).size();
+	return size.isValid() && size.width() <= preview_optimizer::max_dimension && size.height() <= preview_optimizer::max_dimension;
+}
+
+void preview_optimizer::encode(const QImage &image, const std::filesystem::path &output_filepath, const bool lossless)
+{
+	const QString output_filepath_qstr = to_qstring(output_filepath);
+
+	if (lossless) {
+		if (!image.save(output_filepath_qstr, "PNG")) {
+			throw std::runtime_error("Failed to save optimized preview image \"" + to_string(output_filepath) + "\".");
+		}
+
+		return;
+	}
+
+	//lower the quality until the image fits within the size limit
+	for (int quality = preview_optimizer::initial_jpeg_quality; quality >= preview_optimizer::min_jpeg_quality; quality -= preview_optimizer::jpeg_quality_step) {
+		if (!image.save(output_filepath_qstr, "JPG", quality)) {
+			throw std::runtime_error("Failed to save optimized preview image \"" + to_string(output_filepath) + "\".");
+		}
+
+		if (std::filesystem::file_size(output_filepath) <= preview_optimizer::max_file_size) {
+			return;
+		}
+	}
+}
+
+void preview_optimizer::remove_stale_entries(const std::filesystem::path &cache_path, const std::string &source_key)
+{
+	//remove the optimized versions of previous versions of the image
+	const std::string prefix = source_key + "_";
+
+	std::vector<std::filesystem::path> stale_filepaths;
+
+	for (const std::filesystem::directory_entry &dir_entry : std::filesystem::directory_iterator(cache_path)) {
+		if (to_string(dir_entry.path().filename()).starts_with(prefix)) {
+			stale_filepaths.push_back(dir_entry.path());
+		}
+	}
+
+	for (const std::filesystem::path &filepath : stale_filepaths) {
+		std::filesystem::remove(filepath);
+	}
+}
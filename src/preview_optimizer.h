@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+class QImage;
+
+//downscales and re-encodes Workshop preview images which exceed the size budget, caching the results in the user data directory
+class preview_optimizer final
+{
+public:
+	static constexpr uintmax_t max_file_size = 1024 * 1024; //the Workshop's limit for preview images
+	static constexpr int max_dimension = 1024;
+	static constexpr int initial_jpeg_quality = 90;
+	static constexpr int min_jpeg_quality = 50;
+	static constexpr int jpeg_quality_step = 10;
+
+	static std::filesystem::path get_cache_path();
+
+	//get the path to an optimized version of the image, or to the image itself if it is already within the budget; this may be called from a worker thread
+	static std::filesystem::path optimize(const std::filesystem::path &image_filepath, const uint64_t image_hash);
+
+private:
+	static bool is_within_budget(const std::filesystem::path &image_filepath);
+	static void encode(const QImage &image, const std::filesystem::path &output_filepath, const bool lossless);
+	static void remove_stale_entries(const std::filesystem::path &cache_path, const std::string &source_key);
+};
@@ -1,11 +1,56 @@
 #include "process_manager.h"
 
 #include "achievement_manager.h"
+#include "asset_prefetcher.h"
+#include "game_event_server.h"
+#include "game_output_capture.h"
+#include "game_process.h"
+#include "launch_profile.h"
+#include "process_monitor.h"
+#include "steam_initializer.h"
+#include "trace.h"
+#include "util.h"
+#include "workshop_subscription_manager.h"
 
-process_manager::process_manager(const bool clear_achievements) : clear_achievements(clear_achievements)
+#include <algorithm>
+
+process_manager::process_manager(const bool clear_achievements, const game_output_mode output_mode, const prefetch_mode file_prefetch_mode) : output_mode(output_mode), clear_achievements(clear_achievements)
 {
-	this->process = new QProcess;
-	connect(this->process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &process_manager::on_finished);
+	std::error_code error_code;
+	const std::filesystem::path game_path = std::filesystem::weakly_canonical(std::filesystem::current_path(), error_code);
+	this->prefetcher = new asset_prefetcher(game_path, file_prefetch_mode, this);
+
+	if (output_mode == game_output_mode::capture) {
+		this->output_capture = std::make_unique<game_output_capture>();
+		this->output_read_buffer.resize(process_manager::output_read_size);
+	}
+
+	this->monitor = new process_monitor(this);
+
+	this->restart_timer = new QTimer(this);
+	this->restart_timer->setSingleShot(true);
+	connect(this->restart_timer, &QTimer::timeout, this, [this]() {
+		emit restartPendingChanged();
+		this->start();
+	});
+
+	this->event_server = new game_event_server(this);
+	connect(this->event_server, &game_event_server::clientConnected, this, &process_manager::on_game_event_client_connected);
+	connect(this->event_server, &game_event_server::achievementsReceived, this, [this](const std::vector<std::string> &keys) {
+		if (this->achievement_manager != nullptr) {
+			this->achievement_manager->sync_achievements(keys);
+		}
+	});
+	connect(this->event_server, &game_event_server::statReceived, this, [this](const std::string &name, const int32_t value) {
+		if (this->achievement_manager != nullptr) {
+			this->achievement_manager->update_stat(name, value);
+		}
+	});
+	connect(this->event_server, &game_event_server::achievementProgressReceived, this, [this](const std::string &key, const uint32_t current_progress, const uint32_t max_progress) {
+		if (this->achievement_manager != nullptr) {
+			this->achievement_manager->update_achievement_progress(key, current_progress, max_progress);
+		}
+	});
 }
 
 process_manager::~process_manager()
@@ -17,19 +62,310 @@ process_manager::~process_manager()
 
 void process_manager::start()
 {
-	this->achievement_manager = std::make_unique<::achievement_manager>(clear_achievements);
+	if (this->start_pending || this->is_running()) {
+		return;
+	}
+
+	if (this->restart_timer->isActive()) {
+		//start right away instead of waiting for the automatic restart
+		this->restart_timer->stop();
+		emit restartPendingChanged();
+	}
+
+	this->start_request_time = std::chrono::steady_clock::now();
+
+	//start reading the game's files into the page cache right away, while the launcher is still preparing to start it
+	this->prefetcher->start();
+
+	//the achievements are checked before the game starts, which requires Steam to have been initialized
+	this->start_pending = true;
+	steam_initializer::call_when_finished(this, [this]() {
+		if (this->subscription_manager == nullptr) {
+			this->start_pending = false;
+			this->start_process();
+			return;
+		}
+
+		//the game loads all subscribed mods, so it is only started once they are up to date; a sync in progress is joined instead of starting another one
+		this->subscription_manager->sync();
+		this->subscription_manager->call_when_synced(this, [this]() {
+			this->start_pending = false;
+			this->start_process();
+		});
+	});
+}
+
+void process_manager::relaunch()
+{
+	if (!this->resident) {
+		log_error("The game can only be relaunched in resident mode.");
+		return;
+	}
+
+	//a relaunch requested by the player is not part of a crash loop
+	this->consecutive_restart_count = 0;
+
+	this->start();
+}
+
+QStringList process_manager::get_launch_profiles() const
+{
+	try {
+		return launch_profile::get_profile_names();
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+		return QStringList();
+	}
+}
+
+void process_manager::set_launch_profile_name(const QString &name)
+{
+	if (name == this->launch_profile_name) {
+		return;
+	}
+
+	this->launch_profile_name = name;
+	emit launchProfileChanged();
+}
+
+void process_manager::set_resident(const bool resident)
+{
+	if (resident == this->resident) {
+		return;
+	}
+
+	this->resident = resident;
+	emit residentChanged();
+}
+
+void process_manager::set_auto_restart_enabled(const bool auto_restart)
+{
+	if (auto_restart == this->auto_restart) {
+		return;
+	}
+
+	this->auto_restart = auto_restart;
+
+	if (!auto_restart && this->restart_timer->isActive()) {
+		this->restart_timer->stop();
+		emit restartPendingChanged();
+	}
+
+	emit autoRestartChanged();
+}
+
+QProcess *process_manager::create_process(const launch_profile &profile)
+{
+	QProcess *process = new game_process(profile);
+	connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &process_manager::on_finished);
+	connect(process, &QProcess::started, this, &process_manager::on_started);
+	connect(process, &QProcess::errorOccurred, this, &process_manager::on_error);
+
+	//the game's output is always either read or not buffered at all, as otherwise QProcess would keep buffering it for the entire session
+	switch (this->output_mode) {
+		case game_output_mode::capture:
+			process->setProcessChannelMode(QProcess::MergedChannels);
+			connect(process, &QProcess::readyReadStandardOutput, this, &process_manager::read_output);
+			break;
+		case game_output_mode::forward:
+			process->setProcessChannelMode(QProcess::ForwardedChannels);
+			break;
+		case game_output_mode::discard:
+			process->setStandardOutputFile(QProcess::nullDevice());
+			process->setStandardErrorFile(QProcess::nullDevice());
+			break;
+	}
+
+	return process;
+}
+
+void process_manager::start_process()
+{
+	//the profile is loaded for each start, so that changes to it apply without restarting the launcher
+	launch_profile profile;
+
+	try {
+		profile = launch_profile::load(this->launch_profile_name);
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+		log_error("Failed to start the game.");
+		this->prefetcher->cancel();
+		return;
+	}
+
+	//the achievement manager is kept when the game is restarted in resident mode, so that the achievements which were already synchronized need not be checked with Steam again
+	if (this->achievement_manager == nullptr) {
+		this->achievement_manager = std::make_unique<::achievement_manager>(clear_achievements);
+	}
+
 	this->achievement_manager->check_achievements();
-	this->process->start("wyrmsun", QStringList());
+	this->achievement_manager->start_continuous_checking();
+
+	this->process = this->create_process(profile);
+
+	QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+
+	for (const auto &[variable_name, value] : profile.environment) {
+		environment.insert(variable_name, value);
+	}
+
+	//advertise the game event server to the game, so that it can send achievement unlocks directly
+	if (this->event_server->listen()) {
+		environment.insert(game_event_server::environment_variable_name, this->event_server->get_server_name());
+	}
+
+	this->process->setProcessEnvironment(environment);
+
+	if (this->output_capture != nullptr) {
+		this->output_capture->start_session();
+	}
+
+	this->process_start_time = trace_recorder::clock::now();
+	this->process->start("wyrmsun", profile.arguments);
+
+	emit runningChanged();
+}
+
+void process_manager::read_output()
+{
+	//read the output in fixed-size chunks, so that it does not accumulate in memory
+	while (this->process->bytesAvailable() > 0) {
+		const qint64 read_size = this->process->read(this->output_read_buffer.data(), static_cast<qint64>(this->output_read_buffer.size()));
+
+		if (read_size <= 0) {
+			break;
+		}
+
+		this->output_capture->append(this->output_read_buffer.data(), static_cast<size_t>(read_size));
+	}
 }
 
 void process_manager::on_finished(const int exit_code, const QProcess::ExitStatus exit_status)
 {
-	Q_UNUSED(exit_status)
+	if (trace_recorder::is_enabled()) {
+		std::string args;
+		trace_recorder::append_arg(args, "exit_code", exit_code);
+		trace_recorder::append_arg(args, "crashed", exit_status == QProcess::CrashExit ? 1 : 0);
+		trace_recorder::add_async_event("game", "process", trace_recorder::generate_async_id(), this->process_start_time, trace_recorder::clock::now(), std::move(args));
+	}
+
+	this->monitor->stop();
+	this->prefetcher->cancel();
+	this->prefetcher->stop_recording();
+
+	if (this->output_capture != nullptr) {
+		this->read_output();
+		this->output_capture->end_session();
+
+		if (exit_status == QProcess::CrashExit || exit_code != 0) {
+			try {
+				const std::string description = exit_status == QProcess::CrashExit ? "The game crashed." : "The game exited with code " + std::to_string(exit_code) + ".";
+				const std::filesystem::path crash_report_filepath = this->output_capture->write_crash_report(description);
+				log_error(description + " Its last output was written to \"" + to_string(crash_report_filepath) + "\".");
+			} catch (const std::exception &exception) {
+				report_exception(exception);
+			}
+		}
+	}
 
-	QMetaObject::invokeMethod(QApplication::instance(), [exit_code] { QApplication::exit(exit_code); }, Qt::QueuedConnection);
 	this->process->deleteLater();
 	this->process = nullptr;
 
+	this->achievement_manager->stop_continuous_checking();
 	this->achievement_manager->check_achievements();
-	this->achievement_manager.reset();
+
+	//store the changes made at the end of the session right away, as the launcher may be about to exit
+	this->achievement_manager->flush_stats();
+	log("Stat updates: " + std::to_string(this->achievement_manager->get_received_stat_update_count()) + " received, " + std::to_string(this->achievement_manager->get_flushed_stat_update_count()) + " sent to Steam in " + std::to_string(this->achievement_manager->get_store_count()) + " stores.");
+
+	const bool crashed = exit_status == QProcess::CrashExit;
+
+	emit runningChanged();
+	emit gameFinished(exit_code, crashed);
+
+	if (!this->resident) {
+		QMetaObject::invokeMethod(QApplication::instance(), [exit_code] { QApplication::exit(exit_code); }, Qt::QueuedConnection);
+		this->achievement_manager.reset();
+		return;
+	}
+
+	if (crashed || exit_code != 0) {
+		if (this->auto_restart) {
+			this->schedule_restart(std::chrono::steady_clock::now() - this->process_start_time);
+		}
+	} else {
+		this->consecutive_restart_count = 0;
+	}
+}
+
+void process_manager::on_started()
+{
+	const std::chrono::steady_clock::duration start_duration = std::chrono::steady_clock::now() - this->start_request_time;
+	log("Started the game in " + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(start_duration).count()) + " ms.");
+
+	this->monitor->start(this->process->processId());
+	this->prefetcher->start_recording();
+}
+
+void process_manager::on_error(const QProcess::ProcessError error)
+{
+	if (error != QProcess::FailedToStart) {
+		//other errors are followed by the finished signal, if the process had started
+		return;
+	}
+
+	log_error("Failed to start the game: " + this->process->errorString().toStdString());
+
+	this->prefetcher->cancel();
+
+	//close the capture session which was opened for the process, since no finished signal follows
+	if (this->output_capture != nullptr) {
+		this->output_capture->end_session();
+	}
+
+	this->process->deleteLater();
+	this->process = nullptr;
+
+	this->achievement_manager->stop_continuous_checking();
+
+	if (!this->resident) {
+		this->achievement_manager.reset();
+	}
+
+	emit runningChanged();
+}
+
+void process_manager::schedule_restart(const std::chrono::steady_clock::duration run_duration)
+{
+	if (run_duration >= std::chrono::seconds(process_manager::stable_run_seconds)) {
+		this->consecutive_restart_count = 0;
+	}
+
+	if (this->consecutive_restart_count >= process_manager::max_consecutive_restarts) {
+		log_error("The game exited abnormally " + std::to_string(this->consecutive_restart_count + 1) + " times in a row, so it will not be restarted automatically.");
+		return;
+	}
+
+	//back off exponentially, so that a game which crashes on startup is not restarted in a tight loop
+	int delay_ms = process_manager::min_restart_delay_ms;
+	for (int i = 0; i < this->consecutive_restart_count && delay_ms < process_manager::max_restart_delay_ms; ++i) {
+		delay_ms *= 2;
+	}
+	delay_ms = std::min(delay_ms, process_manager::max_restart_delay_ms);
+
+	++this->consecutive_restart_count;
+
+	log("Restarting the game in " + std::to_string(delay_ms) + " ms.");
+	this->restart_timer->start(delay_ms);
+	emit restartPendingChanged();
+}
+
+void process_manager::on_game_event_client_connected()
+{
+	if (this->achievement_manager == nullptr) {
+		return;
+	}
+
+	//the game sends its achievement events directly, so there is no need to watch the achievements file while it runs; it is still checked when the game exits
+	this->achievement_manager->stop_continuous_checking();
 }
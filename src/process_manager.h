@@ -1,24 +1,131 @@
 #pragma once
 
+#include "process_monitor.h"
+
 #include <QApplication>
 #include <QProcess>
+#include <QTimer>
+
+#include <chrono>
+#include <memory>
+#include <vector>
 
 class achievement_manager;
+class asset_prefetcher;
+class game_event_server;
+class game_output_capture;
+class workshop_subscription_manager;
+struct launch_profile;
+enum class game_output_mode;
+enum class prefetch_mode;
 
 class process_manager final : public QObject
 {
 	Q_OBJECT
 
+	Q_PROPERTY(process_monitor* monitor READ get_monitor CONSTANT)
+	Q_PROPERTY(QString launch_profile READ get_launch_profile_name WRITE set_launch_profile_name NOTIFY launchProfileChanged)
+	Q_PROPERTY(bool running READ is_running NOTIFY runningChanged)
+	Q_PROPERTY(bool resident READ is_resident WRITE set_resident NOTIFY residentChanged)
+	Q_PROPERTY(bool auto_restart READ is_auto_restart_enabled WRITE set_auto_restart_enabled NOTIFY autoRestartChanged)
+	Q_PROPERTY(bool restart_pending READ is_restart_pending NOTIFY restartPendingChanged)
+
 public:
-	explicit process_manager(const bool clear_achievements);
+	static constexpr size_t output_read_size = 64 * 1024; //the size of the chunks in which the game's output is read
+	static constexpr int min_restart_delay_ms = 1000; //the delay before automatically restarting the game after its first abnormal exit; it doubles with each further one
+	static constexpr int max_restart_delay_ms = 60000;
+	static constexpr int max_consecutive_restarts = 5; //the number of abnormal exits in a row after which automatic restarting is given up
+	static constexpr int stable_run_seconds = 60; //a game which ran for at least this long before exiting abnormally is not considered to be in a crash loop
+
+	explicit process_manager(const bool clear_achievements, const game_output_mode output_mode, const prefetch_mode file_prefetch_mode);
 	~process_manager();
 
 	Q_INVOKABLE void start();
 
+	//start the game again after it has exited, without the launcher having restarted; only possible in resident mode
+	Q_INVOKABLE void relaunch();
+
+	//get the names of the available launch profiles
+	Q_INVOKABLE QStringList get_launch_profiles() const;
+
+	process_monitor *get_monitor() const
+	{
+		return this->monitor;
+	}
+
+	const QString &get_launch_profile_name() const
+	{
+		return this->launch_profile_name;
+	}
+
+	void set_launch_profile_name(const QString &name);
+
+	bool is_running() const
+	{
+		return this->process != nullptr;
+	}
+
+	bool is_resident() const
+	{
+		return this->resident;
+	}
+
+	void set_resident(const bool resident);
+
+	bool is_auto_restart_enabled() const
+	{
+		return this->auto_restart;
+	}
+
+	void set_auto_restart_enabled(const bool auto_restart);
+
+	bool is_restart_pending() const
+	{
+		return this->restart_timer->isActive();
+	}
+
+	//set the manager whose sync of the subscribed Workshop items the game waits for before being started
+	void set_subscription_manager(workshop_subscription_manager *subscription_manager)
+	{
+		this->subscription_manager = subscription_manager;
+	}
+
 	void on_finished(const int exit_code, const QProcess::ExitStatus exit_status);
 
+signals:
+	void launchProfileChanged();
+	void runningChanged();
+	void residentChanged();
+	void autoRestartChanged();
+	void restartPendingChanged();
+	void gameFinished(const int exit_code, const bool crashed);
+
+private:
+	QProcess *create_process(const launch_profile &profile);
+	void start_process();
+	void read_output();
+	void on_started();
+	void on_error(const QProcess::ProcessError error);
+	void on_game_event_client_connected();
+	void schedule_restart(const std::chrono::steady_clock::duration run_duration);
+
 private:
-	QProcess *process = nullptr;
-	std::unique_ptr<achievement_manager> achievement_manager;
+	QProcess *process = nullptr; //the process of the running game, created for each start
+	game_output_mode output_mode;
+	game_event_server *event_server = nullptr;
+	process_monitor *monitor = nullptr;
+	asset_prefetcher *prefetcher = nullptr;
+	workshop_subscription_manager *subscription_manager = nullptr; //null if the subscribed Workshop items are not synchronized
+	std::unique_ptr<achievement_manager> achievement_manager; //kept across game restarts in resident mode
+	std::unique_ptr<game_output_capture> output_capture; //null if the game's output is not captured
+	std::vector<char> output_read_buffer;
 	bool clear_achievements = false;
+	QString launch_profile_name = "default";
+	std::chrono::steady_clock::time_point start_request_time; //the time at which starting the game was requested, to measure how long it takes to start
+	std::chrono::steady_clock::time_point process_start_time;
+	bool start_pending = false; //whether the game is waiting for Steam initialization or the Workshop item sync to finish before being started
+	bool resident = false; //whether the launcher keeps running after the game exits
+	bool auto_restart = false; //whether the game is restarted automatically after exiting abnormally, in resident mode
+	QTimer *restart_timer = nullptr;
+	int consecutive_restart_count = 0;
 };
@@ -0,0 +1,330 @@
+#include "process_monitor.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+//read a small file from /proc into the buffer, returning the number of bytes read, or 0 on failure
+static size_t read_proc_file(const std::string &filepath, char *buffer, const size_t buffer_size)
+{
+	const int fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		return 0;
+	}
+
+	size_t size = 0;
+
+	while (size < buffer_size - 1) {
+		const ssize_t read_size = ::read(fd, buffer + size, buffer_size - 1 - size);
+		if (read_size <= 0) {
+			break;
+		}
+
+		size += static_cast<size_t>(read_size);
+	}
+
+	::close(fd);
+
+	buffer[size] = '\0';
+	return size;
+}
+
+//get the value of a "key: value" line in /proc/<pid>/io
+static uint64_t find_proc_io_value(const std::string_view &data, const std::string_view &key)
+{
+	size_t pos = 0;
+
+	while (pos < data.size()) {
+		size_t end_pos = data.find('\n', pos);
+		if (end_pos == std::string_view::npos) {
+			end_pos = data.size();
+		}
+
+		const std::string_view line = data.substr(pos, end_pos - pos);
+		if (line.size() > key.size() && line.substr(0, key.size()) == key && line[key.size()] == ':') {
+			return std::strtoull(line.data() + key.size() + 1, nullptr, 10);
+		}
+
+		pos = end_pos + 1;
+	}
+
+	return 0;
+}
+#endif
+
+bool process_monitor::is_supported()
+{
+#ifdef __linux__
+	return true;
+#else
+	return false;
+#endif
+}
+
+process_monitor::process_monitor(QObject *parent) : QObject(parent)
+{
+	this->timer = new QTimer(this);
+	this->timer->setTimerType(Qt::CoarseTimer);
+	connect(this->timer, &QTimer::timeout, this, &process_monitor::take_sample);
+
+	this->samples.resize(process_monitor::sample_history_size);
+}
+
+void process_monitor::start(const qint64 pid)
+{
+	if (!process_monitor::is_supported() || this->sample_interval_ms <= 0 || pid <= 0) {
+		return;
+	}
+
+	this->pid = pid;
+	this->next_sample_index = 0;
+	this->sample_count = 0;
+	this->cpu_usage = 0;
+	this->peak_cpu_usage = 0;
+	this->peak_resident_memory = 0;
+	this->stall_count = 0;
+	this->longest_stall = std::chrono::steady_clock::duration::zero();
+	this->start_time = std::chrono::steady_clock::now();
+	this->last_cpu_progress_time = this->start_time;
+	this->set_stalled(false);
+
+	this->take_sample();
+	this->timer->start(this->sample_interval_ms);
+
+	emit activeChanged();
+}
+
+void process_monitor::stop()
+{
+	if (!this->is_active()) {
+		return;
+	}
+
+	this->timer->stop();
+
+	if (this->stalled) {
+		this->longest_stall = std::max(this->longest_stall, this->last_sample().time - this->last_cpu_progress_time);
+		this->set_stalled(false);
+	}
+
+	this->log_summary();
+
+	this->pid = 0;
+	emit activeChanged();
+}
+
+void process_monitor::set_sample_interval_ms(const int interval_ms)
+{
+	if (interval_ms == this->sample_interval_ms) {
+		return;
+	}
+
+	this->sample_interval_ms = interval_ms;
+
+	//sampling is resumed if it was turned off during the session
+	if (this->is_active()) {
+		if (interval_ms > 0) {
+			this->timer->start(interval_ms);
+		} else {
+			this->timer->stop();
+		}
+	}
+
+	emit sampleIntervalChanged();
+}
+
+std::vector<process_monitor::sample> process_monitor::get_samples() const
+{
+	std::vector<sample> ordered_samples;
+
+	const size_t count = std::min(this->sample_count, this->samples.size());
+	ordered_samples.reserve(count);
+
+	const size_t first_index = this->sample_count > this->samples.size() ? this->next_sample_index : 0;
+	for (size_t i = 0; i < count; ++i) {
+		ordered_samples.push_back(this->samples[(first_index + i) % this->samples.size()]);
+	}
+
+	return ordered_samples;
+}
+
+const process_monitor::sample &process_monitor::last_sample() const
+{
+	if (this->sample_count == 0) {
+		static const sample empty_sample;
+		return empty_sample;
+	}
+
+	return this->samples[(this->next_sample_index + this->samples.size() - 1) % this->samples.size()];
+}
+
+bool process_monitor::read_sample(sample &sample) const
+{
+#ifdef __linux__
+	static const long clock_ticks_per_second = sysconf(_SC_CLK_TCK);
+	static const long page_size = sysconf(_SC_PAGESIZE);
+
+	const std::string proc_path = "/proc/" + std::to_string(this->pid);
+
+	//the buffer is large enough for the stat and io files, which are of a few hundred bytes
+	char buffer[1024];
+
+	if (read_proc_file(proc_path + "/stat", buffer, sizeof(buffer)) == 0) {
+		return false;
+	}
+
+	//the process name is in parentheses and may contain spaces, so the fields are counted from the last closing parenthesis; the state is the 3rd field
+	const char *fields = std::strrchr(buffer, ')');
+	if (fields == nullptr) {
+		return false;
+	}
+
+	uint64_t stat_values[13]{};
+	const char *pos = fields + 1;
+	for (size_t i = 0; i < std::size(stat_values); ++i) {
+		while (*pos == ' ') {
+			++pos;
+		}
+
+		if (*pos == '\0') {
+			return false;
+		}
+
+		char *end_pos = nullptr;
+		stat_values[i] = std::strtoull(pos, &end_pos, 10);
+
+		//skip over non-numeric fields, such as the state
+		while (*end_pos != ' ' && *end_pos != '\0') {
+			++end_pos;
+		}
+
+		pos = end_pos;
+	}
+
+	//the values are for the fields from the 3rd onwards: minflt is the 10th field, majflt the 12th, utime the 14th and stime the 15th
+	sample.minor_page_faults = stat_values[7];
+	sample.major_page_faults = stat_values[9];
+	sample.cpu_ticks = stat_values[11] + stat_values[12];
+
+	if (read_proc_file(proc_path + "/statm", buffer, sizeof(buffer)) > 0) {
+		const char *resident_pos = std::strchr(buffer, ' ');
+		if (resident_pos != nullptr) {
+			sample.resident_memory = std::strtoull(resident_pos + 1, nullptr, 10) * static_cast<uint64_t>(page_size);
+		}
+	}
+
+	//the io file may not be readable, e.g. if the kernel does not provide I/O accounting
+	const size_t io_size = read_proc_file(proc_path + "/io", buffer, sizeof(buffer));
+	if (io_size > 0) {
+		const std::string_view io_data(buffer, io_size);
+		sample.read_bytes = find_proc_io_value(io_data, "read_bytes");
+		sample.written_bytes = find_proc_io_value(io_data, "write_bytes");
+	}
+
+	sample.time = std::chrono::steady_clock::now();
+
+	//convert the CPU time to milliseconds, so that it does not depend on the clock tick rate
+	sample.cpu_ticks = sample.cpu_ticks * 1000 / static_cast<uint64_t>(clock_ticks_per_second);
+
+	return true;
+#else
+	Q_UNUSED(sample)
+
+	return false;
+#endif
+}
+
+void process_monitor::take_sample()
+{
+	sample new_sample;
+
+	if (!this->read_sample(new_sample)) {
+		//the process may have exited without the finished signal having been processed yet
+		return;
+	}
+
+	if (this->sample_count == 0) {
+		this->first_sample = new_sample;
+	} else {
+		const sample &previous_sample = this->last_sample();
+		const double elapsed_ms = std::chrono::duration<double, std::milli>(new_sample.time - previous_sample.time).count();
+
+		if (elapsed_ms > 0) {
+			this->cpu_usage = static_cast<double>(new_sample.cpu_ticks - previous_sample.cpu_ticks) * 100. / elapsed_ms;
+			this->peak_cpu_usage = std::max(this->peak_cpu_usage, this->cpu_usage);
+		}
+
+		if (new_sample.cpu_ticks != previous_sample.cpu_ticks) {
+			if (this->stalled) {
+				this->longest_stall = std::max(this->longest_stall, new_sample.time - this->last_cpu_progress_time);
+			}
+
+			this->last_cpu_progress_time = new_sample.time;
+			this->set_stalled(false);
+		} else if (!this->stalled && new_sample.time - this->last_cpu_progress_time >= std::chrono::seconds(process_monitor::stall_threshold_seconds)) {
+			++this->stall_count;
+			this->set_stalled(true);
+			log_error("The game has not used any CPU time for " + std::to_string(process_monitor::stall_threshold_seconds) + " seconds.");
+		}
+	}
+
+	this->peak_resident_memory = std::max(this->peak_resident_memory, new_sample.resident_memory);
+
+	this->samples[this->next_sample_index] = new_sample;
+	this->next_sample_index = (this->next_sample_index + 1) % this->samples.size();
+	++this->sample_count;
+
+	emit sampled();
+}
+
+void process_monitor::set_stalled(const bool stalled)
+{
+	if (stalled == this->stalled) {
+		return;
+	}
+
+	this->stalled = stalled;
+	emit stalledChanged();
+}
+
+void process_monitor::log_summary() const
+{
+	if (this->sample_count == 0) {
+		return;
+	}
+
+	const sample &final_sample = this->last_sample();
+	const double duration_s = std::chrono::duration<double>(final_sample.time - this->start_time).count();
+	const double cpu_time_s = static_cast<double>(final_sample.cpu_ticks - this->first_sample.cpu_ticks) / 1000.;
+	const double average_cpu_usage = duration_s > 0 ? cpu_time_s * 100. / duration_s : 0;
+
+	const auto to_mib_string = [](const uint64_t bytes) {
+		return std::to_string(bytes / (1024 * 1024)) + " MiB";
+	};
+
+	std::string summary = "Game resource use: ";
+	summary += std::to_string(static_cast<int64_t>(duration_s)) + " s monitored in " + std::to_string(this->sample_count) + " samples";
+	summary += ", CPU average " + std::to_string(static_cast<int>(average_cpu_usage)) + "% / peak " + std::to_string(static_cast<int>(this->peak_cpu_usage)) + "%";
+	summary += ", resident memory final " + to_mib_string(final_sample.resident_memory) + " / peak " + to_mib_string(this->peak_resident_memory);
+	summary += ", page faults " + std::to_string(final_sample.minor_page_faults) + " minor / " + std::to_string(final_sample.major_page_faults) + " major";
+	summary += ", I/O " + to_mib_string(final_sample.read_bytes) + " read / " + to_mib_string(final_sample.written_bytes) + " written";
+	summary += ", " + std::to_string(this->stall_count) + " stalls";
+
+	if (this->stall_count > 0) {
+		summary += " (longest " + std::to_string(std::chrono::duration_cast<std::chrono::seconds>(this->longest_stall).count()) + " s)";
+	}
+
+	summary += ".";
+
+	log(summary);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+//samples the resource use of a running process at a fixed interval, keeping the samples in a fixed-size ring buffer
+//the values are read from the /proc filesystem, so the monitor only works on Linux
+class process_monitor final : public QObject
+{
+	Q_OBJECT
+
+	Q_PROPERTY(bool active READ is_active NOTIFY activeChanged)
+	Q_PROPERTY(int sample_interval_ms READ get_sample_interval_ms WRITE set_sample_interval_ms NOTIFY sampleIntervalChanged)
+	Q_PROPERTY(double cpu_usage READ get_cpu_usage NOTIFY sampled)
+	Q_PROPERTY(quint64 resident_memory READ get_resident_memory NOTIFY sampled)
+	Q_PROPERTY(quint64 page_faults READ get_page_faults NOTIFY sampled)
+	Q_PROPERTY(quint64 major_page_faults READ get_major_page_faults NOTIFY sampled)
+	Q_PROPERTY(quint64 read_bytes READ get_read_bytes NOTIFY sampled)
+	Q_PROPERTY(quint64 written_bytes READ get_written_bytes NOTIFY sampled)
+	Q_PROPERTY(bool stalled READ is_stalled NOTIFY stalledChanged)
+
+public:
+	static constexpr int default_sample_interval_ms = 1000;
+	static constexpr size_t sample_history_size = 600; //the number of samples kept, i.e. the last 10 minutes with the default interval
+	static constexpr int stall_threshold_seconds = 10; //the time without any CPU progress after which the process is considered to be stalled
+
+	struct sample final
+	{
+		std::chrono::steady_clock::time_point time;
+		uint64_t cpu_ticks = 0; //the user and system CPU time used by the process
+		uint64_t resident_memory = 0;
+		uint64_t minor_page_faults = 0;
+		uint64_t major_page_faults = 0;
+		uint64_t read_bytes = 0;
+		uint64_t written_bytes = 0;
+	};
+
+	static bool is_supported();
+
+	explicit process_monitor(QObject *parent = nullptr);
+
+	void start(const qint64 pid);
+
+	//stop monitoring, and log a summary of the process' resource use
+	void stop();
+
+	bool is_active() const
+	{
+		return this->pid != 0;
+	}
+
+	int get_sample_interval_ms() const
+	{
+		return this->sample_interval_ms;
+	}
+
+	void set_sample_interval_ms(const int interval_ms);
+
+	double get_cpu_usage() const
+	{
+		return this->cpu_usage;
+	}
+
+	quint64 get_resident_memory() const
+	{
+		return this->last_sample().resident_memory;
+	}
+
+	quint64 get_page_faults() const
+	{
+		return this->last_sample().minor_page_faults + this->last_sample().major_page_faults;
+	}
+
+	quint64 get_major_page_faults() const
+	{
+		return this->last_sample().major_page_faults;
+	}
+
+	quint64 get_read_bytes() const
+	{
+		return this->last_sample().read_bytes;
+	}
+
+	quint64 get_written_bytes() const
+	{
+		return this->last_sample().written_bytes;
+	}
+
+	bool is_stalled() const
+	{
+		return this->stalled;
+	}
+
+	//get the samples from the oldest to the newest
+	std::vector<sample> get_samples() const;
+
+signals:
+	void activeChanged();
+	void sampleIntervalChanged();
+	void sampled();
+	void stalledChanged();
+
+private:
+	const sample &last_sample() const;
+	bool read_sample(sample &sample) const;
+	void take_sample();
+	void set_stalled(const bool stalled);
+	void log_summary() const;
+
+private:
+	QTimer *timer = nullptr;
+	int sample_interval_ms = process_monitor::default_sample_interval_ms;
+	qint64 pid = 0;
+	std::vector<sample> samples; //ring buffer
+	size_t next_sample_index = 0;
+	size_t sample_count = 0; //the total number of samples taken for the process
+	sample first_sample;
+	double cpu_usage = 0; //the CPU usage between the last two samples, in percent of a single core
+	double peak_cpu_usage = 0;
+	uint64_t peak_resident_memory = 0;
+	std::chrono::steady_clock::time_point start_time;
+	std::chrono::steady_clock::time_point last_cpu_progress_time;
+	bool stalled = false;
+	int stall_count = 0;
+	std::chrono::steady_clock::duration longest_stall = std::chrono::steady_clock::duration::zero();
+};
@@ -0,0 +1,314 @@
+#include "steam_api_backend.h"
+
+#include "steam/steam_api.h"
+#include "util.h"
+
+#include <algorithm>
+
+bool steam_api_backend::init()
+{
+	this->initialized = SteamAPI_Init();
+
+	if (this->initialized) {
+		this->user_stats_received_callback.Register(this, &steam_api_backend::on_user_stats_received);
+		this->user_stats_stored_callback.Register(this, &steam_api_backend::on_user_stats_stored);
+		this->item_downloaded_callback.Register(this, &steam_api_backend::on_item_downloaded);
+	}
+
+	return this->initialized;
+}
+
+void steam_api_backend::shutdown()
+{
+	this->pending_calls.clear();
+	this->stats_request_pending = false;
+	this->stats_request_retry_scheduled = false;
+	this->pending_stats_stores.clear();
+
+	if (this->initialized) {
+		this->user_stats_received_callback.Unregister();
+		this->user_stats_stored_callback.Unregister();
+		this->item_downloaded_callback.Unregister();
+
+		SteamAPI_Shutdown();
+		this->initialized = false;
+	}
+}
+
+void steam_api_backend::run_callbacks()
+{
+	SteamAPI_RunCallbacks();
+
+	//completed calls are only removed after the callbacks have run, since they cannot be destroyed while their own callback is executing
+	const size_t completed_call_count = this->pending_calls.remove_if([](const std::unique_ptr<pending_call> &call) {
+		return call->is_completed();
+	});
+
+	for (size_t i = 0; i < completed_call_count; ++i) {
+		this->on_callback_dispatched();
+	}
+
+	this->check_stats_timeouts();
+}
+
+size_t steam_api_backend::get_pending_call_count() const
+{
+	size_t count = static_cast<size_t>(std::count_if(this->pending_calls.begin(), this->pending_calls.end(), [](const std::unique_ptr<pending_call> &call) {
+		return !call->is_completed();
+	}));
+
+	if (this->stats_request_pending) {
+		++count;
+	}
+
+	//progress indications are not counted, since nothing waits for their result, and neither are timed out stores
+	count += static_cast<size_t>(std::count_if(this->pending_stats_stores.begin(), this->pending_stats_stores.end(), [](const pending_stats_store &store) {
+		return !store.progress_indication && !store.timed_out;
+	}));
+
+	return count;
+}
+
+bool steam_api_backend::is_user_stats_available() const
+{
+	return SteamUserStats() != nullptr;
+}
+
+bool steam_api_backend::request_current_stats()
+{
+	const bool result = SteamUserStats()->RequestCurrentStats();
+
+	if (result) {
+		this->stats_request_pending = true;
+		this->stats_request_time = std::chrono::steady_clock::now();
+		this->stats_request_retry_scheduled = false;
+		this->on_call_issued();
+	}
+
+	return result;
+}
+
+bool steam_api_backend::get_achievement(const char *name, bool *achieved)
+{
+	return SteamUserStats()->GetAchievement(name, achieved);
+}
+
+bool steam_api_backend::is_achievement_registered(const char *name)
+{
+	//the display attribute is empty for achievements which are not in the schema
+	const char *display_name = SteamUserStats()->GetAchievementDisplayAttribute(name, "name");
+	return display_name != nullptr && display_name[0] != '\0';
+}
+
+bool steam_api_backend::set_achievement(const char *name)
+{
+	return SteamUserStats()->SetAchievement(name);
+}
+
+bool steam_api_backend::clear_achievement(const char *name)
+{
+	return SteamUserStats()->ClearAchievement(name);
+}
+
+bool steam_api_backend::set_stat(const char *name, const int32 value)
+{
+	return SteamUserStats()->SetStat(name, value);
+}
+
+bool steam_api_backend::indicate_achievement_progress(const char *name, const uint32 current_progress, const uint32 max_progress)
+{
+	const bool result = SteamUserStats()->IndicateAchievementProgress(name, current_progress, max_progress);
+
+	//the indication results in a UserStatsStored_t callback, which needs to be told apart from those of stores
+	if (result) {
+		this->pending_stats_stores.push_back(pending_stats_store{ true, false, std::chrono::steady_clock::now() });
+	}
+
+	return result;
+}
+
+bool steam_api_backend::store_stats()
+{
+	const bool result = SteamUserStats()->StoreStats();
+
+	if (result) {
+		this->pending_stats_stores.push_back(pending_stats_store{ false, false, std::chrono::steady_clock::now() });
+		this->on_call_issued();
+	}
+
+	return result;
+}
+
+bool steam_api_backend::is_ugc_available() const
+{
+	return SteamUGC() != nullptr;
+}
+
+void steam_api_backend::create_item(const AppId_t app_id, const EWorkshopFileType file_type, call_result_function<CreateItemResult_t> &&function)
+{
+	const SteamAPICall_t call_handle = SteamUGC()->CreateItem(app_id, file_type);
+	this->add_pending_call(call_handle, steam_backend::trace_call_result("CreateItem", std::move(function)));
+}
+
+UGCUpdateHandle_t steam_api_backend::start_item_update(const AppId_t app_id, const PublishedFileId_t published_file_id)
+{
+	return SteamUGC()->StartItemUpdate(app_id, published_file_id);
+}
+
+bool steam_api_backend::set_item_title(const UGCUpdateHandle_t update_handle, const char *title)
+{
+	return SteamUGC()->SetItemTitle(update_handle, title);
+}
+
+bool steam_api_backend::set_item_content(const UGCUpdateHandle_t update_handle, const char *content_folder)
+{
+	return SteamUGC()->SetItemContent(update_handle, content_folder);
+}
+
+bool steam_api_backend::set_item_preview(const UGCUpdateHandle_t update_handle, const char *preview_file)
+{
+	return SteamUGC()->SetItemPreview(update_handle, preview_file);
+}
+
+void steam_api_backend::submit_item_update(const UGCUpdateHandle_t update_handle, const char *change_note, call_result_function<SubmitItemUpdateResult_t> &&function)
+{
+	const SteamAPICall_t call_handle = SteamUGC()->SubmitItemUpdate(update_handle, change_note);
+	this->add_pending_call(call_handle, steam_backend::trace_call_result("SubmitItemUpdate", std::move(function)));
+}
+
+EItemUpdateStatus steam_api_backend::get_item_update_progress(const UGCUpdateHandle_t update_handle, uint64 *bytes_processed, uint64 *bytes_total)
+{
+	return SteamUGC()->GetItemUpdateProgress(update_handle, bytes_processed, bytes_total);
+}
+
+uint32 steam_api_backend::get_num_subscribed_items()
+{
+	return SteamUGC()->GetNumSubscribedItems();
+}
+
+uint32 steam_api_backend::get_subscribed_items(PublishedFileId_t *published_file_ids, const uint32 max_entries)
+{
+	return SteamUGC()->GetSubscribedItems(published_file_ids, max_entries);
+}
+
+uint32 steam_api_backend::get_item_state(const PublishedFileId_t published_file_id)
+{
+	return SteamUGC()->GetItemState(published_file_id);
+}
+
+bool steam_api_backend::get_item_install_info(const PublishedFileId_t published_file_id, uint64 *size_on_disk, char *folder, const uint32 folder_size, uint32 *timestamp)
+{
+	return SteamUGC()->GetItemInstallInfo(published_file_id, size_on_disk, folder, folder_size, timestamp);
+}
+
+bool steam_api_backend::get_item_download_info(const PublishedFileId_t published_file_id, uint64 *bytes_downloaded, uint64 *bytes_total)
+{
+	return SteamUGC()->GetItemDownloadInfo(published_file_id, bytes_downloaded, bytes_total);
+}
+
+bool steam_api_backend::download_item(const PublishedFileId_t published_file_id, const bool high_priority)
+{
+	return SteamUGC()->DownloadItem(published_file_id, high_priority);
+}
+
+void steam_api_backend::on_user_stats_received(UserStatsReceived_t *callback)
+{
+	if (this->stats_request_pending) {
+		std::string args;
+		trace_recorder::append_arg(args, "result", static_cast<int64_t>(callback->m_eResult));
+		trace_recorder::add_async_event("RequestCurrentStats", "steam", trace_recorder::generate_async_id(), this->stats_request_time, trace_recorder::clock::now(), std::move(args));
+	}
+
+	this->stats_request_pending = false;
+	this->on_callback_dispatched();
+
+	if (callback->m_eResult == k_EResultOK) {
+		this->stats_request_retry_scheduled = false;
+		this->stats_request_retry_interval = steam_api_backend::min_stats_request_retry_interval;
+		this->notify_user_stats_received();
+	} else if (!this->is_user_stats_received()) {
+		this->schedule_stats_request_retry();
+	}
+}
+
+void steam_api_backend::on_user_stats_stored(UserStatsStored_t *callback)
+{
+	this->on_callback_dispatched();
+
+	//a callback without a pending call is not for a call made by the launcher
+	if (this->pending_stats_stores.empty()) {
+		return;
+	}
+
+	const pending_stats_store store = this->pending_stats_stores.front();
+	this->pending_stats_stores.pop_front();
+
+	std::string args;
+	trace_recorder::append_arg(args, "result", static_cast<int64_t>(callback->m_eResult));
+	trace_recorder::add_async_event(store.progress_indication ? "IndicateAchievementProgress" : "StoreStats", "steam", trace_recorder::generate_async_id(), store.start_time, trace_recorder::clock::now(), std::move(args));
+
+	//only the results of stores are passed on, so that the result of a progress indication is not taken for that of a store made before it; the result of a timed out store has been passed on as a timeout already
+	if (!store.progress_indication && !store.timed_out) {
+		this->notify_user_stats_stored(callback->m_eResult);
+	}
+}
+
+void steam_api_backend::on_item_downloaded(DownloadItemResult_t *callback)
+{
+	//the callback is also sent for the items of other applications, e.g. if they are downloaded by the Steam client in the background
+	if (callback->m_unAppID != SteamUtils()->GetAppID()) {
+		return;
+	}
+
+	this->on_callback_dispatched();
+	this->notify_item_downloaded(callback->m_nPublishedFileId, callback->m_eResult);
+}
+
+void steam_api_backend::check_stats_timeouts()
+{
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	//the stats callbacks have no call handle, so a result which never arrives has to be given up on after a while
+	if (this->stats_request_pending && now - this->stats_request_time >= steam_api_backend::stats_callback_timeout) {
+		log_error("Timed out waiting for the current user's stats from Steam.");
+		this->stats_request_pending = false;
+
+		if (!this->is_user_stats_received()) {
+			this->schedule_stats_request_retry();
+		}
+	}
+
+	if (this->stats_request_retry_scheduled && now >= this->stats_request_retry_time) {
+		this->stats_request_retry_scheduled = false;
+
+		if (this->is_user_stats_available() && !this->request_current_stats()) {
+			this->schedule_stats_request_retry();
+		}
+	}
+
+	//a callback which is lost for good would otherwise make each later callback be taken for the result of the call before it
+	while (!this->pending_stats_stores.empty() && this->pending_stats_stores.front().timed_out && now - this->pending_stats_stores.front().start_time >= steam_api_backend::late_stats_callback_timeout) {
+		this->pending_stats_stores.pop_front();
+	}
+
+	for (pending_stats_store &store : this->pending_stats_stores) {
+		if (store.timed_out || now - store.start_time < steam_api_backend::stats_callback_timeout) {
+			continue;
+		}
+
+		store.timed_out = true;
+
+		if (!store.progress_indication) {
+			log_error("Timed out waiting for Steam to store the current user's stats.");
+			this->notify_user_stats_stored(k_EResultTimeout);
+		}
+	}
+}
+
+void steam_api_backend::schedule_stats_request_retry()
+{
+	//the retry is made by check_stats_timeouts(), which runs with the callbacks
+	this->stats_request_retry_scheduled = true;
+	this->stats_request_retry_time = std::chrono::steady_clock::now() + this->stats_request_retry_interval;
+	this->stats_request_retry_interval = std::min(this->stats_request_retry_interval * 2, steam_api_backend::max_stats_request_retry_interval);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "steam_backend.h"
+
+#include <chrono>
+#include <deque>
+#include <list>
+
+//Steam backend which forwards calls to the Steam API
+class steam_api_backend final : public steam_backend
+{
+private:
+	//base class for pending asynchronous calls, so that they can be kept in a single list
+	class pending_call
+	{
+	public:
+		virtual ~pending_call()
+		{
+		}
+
+		bool is_completed() const
+		{
+			return this->completed;
+		}
+
+	protected:
+		bool completed = false;
+	};
+
+	//a call which results in a UserStatsStored_t callback; achievement progress indications result in one as well, though they do not store the stats
+	struct pending_stats_store final
+	{
+		bool progress_indication = false;
+		bool timed_out = false; //whether the result is no longer waited for; the callback is still expected, so that a late one is not taken for the result of a later call
+		std::chrono::steady_clock::time_point start_time;
+	};
+
+	template <typename result_type>
+	class pending_call_result final : public pending_call
+	{
+	public:
+		explicit pending_call_result(const SteamAPICall_t call_handle, call_result_function<result_type> &&function) : function(std::move(function))
+		{
+			this->call_result.Set(call_handle, this, &pending_call_result::on_completed);
+		}
+
+	private:
+		void on_completed(result_type *result, const bool io_failure)
+		{
+			this->completed = true;
+			this->function(io_failure ? nullptr : result, io_failure);
+		}
+
+	private:
+		call_result_function<result_type> function;
+		CCallResult<pending_call_result, result_type> call_result;
+	};
+
+public:
+	static constexpr std::chrono::seconds stats_callback_timeout = std::chrono::seconds(30); //the time after which the result of a stats request or store is no longer waited for, so that a lost result does not keep the callbacks running at the busy interval
+	static constexpr std::chrono::seconds late_stats_callback_timeout = std::chrono::seconds(60); //the time after which the callback of a timed out store is considered lost, so that it no longer takes the place of the callbacks of later calls
+	static constexpr std::chrono::seconds min_stats_request_retry_interval = std::chrono::seconds(5); //the initial time to wait before requesting the stats again after a request failed, which is doubled after each failed retry
+	static constexpr std::chrono::seconds max_stats_request_retry_interval = std::chrono::seconds(5 * 60);
+
+	virtual bool init() override;
+	virtual void shutdown() override;
+	virtual void run_callbacks() override;
+	virtual size_t get_pending_call_count() const override;
+
+	virtual bool is_user_stats_available() const override;
+	virtual bool request_current_stats() override;
+	virtual bool get_achievement(const char *name, bool *achieved) override;
+	virtual bool is_achievement_registered(const char *name) override;
+	virtual bool set_achievement(const char *name) override;
+	virtual bool clear_achievement(const char *name) override;
+	virtual bool set_stat(const char *name, const int32 value) override;
+	virtual bool indicate_achievement_progress(const char *name, const uint32 current_progress, const uint32 max_progress) override;
+	virtual bool store_stats() override;
+
+	virtual bool is_ugc_available() const override;
+	virtual void create_item(const AppId_t app_id, const EWorkshopFileType file_type, call_result_function<CreateItemResult_t> &&function) override;
+	virtual UGCUpdateHandle_t start_item_update(const AppId_t app_id, const PublishedFileId_t published_file_id) override;
+	virtual bool set_item_title(const UGCUpdateHandle_t update_handle, const char *title) override;
+	virtual bool set_item_content(const UGCUpdateHandle_t update_handle, const char *content_folder) override;
+	virtual bool set_item_preview(const UGCUpdateHandle_t update_handle, const char *preview_file) override;
+	virtual void submit_item_update(const UGCUpdateHandle_t update_handle, const char *change_note, call_result_function<SubmitItemUpdateResult_t> &&function) override;
+	virtual EItemUpdateStatus get_item_update_progress(const UGCUpdateHandle_t update_handle, uint64 *bytes_processed, uint64 *bytes_total) override;
+
+	virtual uint32 get_num_subscribed_items() override;
+	virtual uint32 get_subscribed_items(PublishedFileId_t *published_file_ids, const uint32 max_entries) override;
+	virtual uint32 get_item_state(const PublishedFileId_t published_file_id) override;
+	virtual bool get_item_install_info(const PublishedFileId_t published_file_id, uint64 *size_on_disk, char *folder, const uint32 folder_size, uint32 *timestamp) override;
+	virtual bool get_item_download_info(const PublishedFileId_t published_file_id, uint64 *bytes_downloaded, uint64 *bytes_total) override;
+	virtual bool download_item(const PublishedFileId_t published_file_id, const bool high_priority) override;
+
+private:
+	void on_user_stats_received(UserStatsReceived_t *callback);
+	void on_user_stats_stored(UserStatsStored_t *callback);
+	void on_item_downloaded(DownloadItemResult_t *callback);
+	void check_stats_timeouts();
+	void schedule_stats_request_retry();
+
+	template <typename result_type>
+	void add_pending_call(const SteamAPICall_t call_handle, call_result_function<result_type> &&function)
+	{
+		if (call_handle == k_uAPICallInvalid) {
+			function(nullptr, true);
+			return;
+		}
+
+		this->pending_calls.push_back(std::make_unique<pending_call_result<result_type>>(call_handle, std::move(function)));
+		this->on_call_issued();
+	}
+
+private:
+	bool initialized = false;
+	std::list<std::unique_ptr<pending_call>> pending_calls;
+	bool stats_request_pending = false;
+	std::chrono::steady_clock::time_point stats_request_time;
+	bool stats_request_retry_scheduled = false;
+	std::chrono::steady_clock::time_point stats_request_retry_time;
+	std::chrono::seconds stats_request_retry_interval = steam_api_backend::min_stats_request_retry_interval;
+	std::deque<pending_stats_store> pending_stats_stores; //the calls whose UserStatsStored_t callback has not been received yet, in the order in which they were made, since the callbacks are received in that order
+	CCallbackManual<steam_api_backend, UserStatsReceived_t> user_stats_received_callback;
+	CCallbackManual<steam_api_backend, UserStatsStored_t> user_stats_stored_callback;
+	CCallbackManual<steam_api_backend, DownloadItemResult_t> item_downloaded_callback;
+};
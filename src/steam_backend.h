@@ -0,0 +1,171 @@
+#pragma once
+
+#include "steam/isteamugc.h"
+#include "steam/isteamuserstats.h"
+#include "steam/steam_api_common.h"
+#include "trace.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+//interface for the Steam API functionality used by the launcher, so that it can be replaced by a local implementation, e.g. for benchmarking
+class steam_backend
+{
+public:
+	//function called when an asynchronous call completes; the result is null if an I/O failure occurred
+	template <typename result_type>
+	using call_result_function = std::function<void(result_type *result, const bool io_failure)>;
+
+	static steam_backend *get()
+	{
+		return steam_backend::instance.get();
+	}
+
+	static void set(std::unique_ptr<steam_backend> &&backend)
+	{
+		steam_backend::instance = std::move(backend);
+	}
+
+private:
+	static inline std::unique_ptr<steam_backend> instance;
+
+public:
+	virtual ~steam_backend()
+	{
+	}
+
+	virtual bool init() = 0;
+	virtual void shutdown() = 0;
+	virtual void run_callbacks() = 0;
+
+	//get the number of asynchronous calls and stats requests whose results have not been received yet
+	virtual size_t get_pending_call_count() const = 0;
+
+	uint64_t get_dispatched_callback_count() const
+	{
+		return this->dispatched_callback_count;
+	}
+
+	//set a function to be called whenever an asynchronous call is made, so that its result can be dispatched without waiting for the next idle callback run
+	void set_call_issued_function(std::function<void()> &&function)
+	{
+		this->call_issued_function = std::move(function);
+	}
+
+	//whether the current user's stats have been received from Steam, which is needed before achievements can be read or changed
+	bool is_user_stats_received() const
+	{
+		return this->user_stats_received;
+	}
+
+	//set a function to be called whenever the current user's stats have been received
+	void set_user_stats_received_function(std::function<void()> &&function)
+	{
+		this->user_stats_received_function = std::move(function);
+	}
+
+	//set a function to be called with the result of each store_stats() call which succeeded, in the order of the calls
+	void set_user_stats_stored_function(std::function<void(const EResult result)> &&function)
+	{
+		this->user_stats_stored_function = std::move(function);
+	}
+
+	virtual bool is_user_stats_available() const = 0;
+	virtual bool request_current_stats() = 0;
+	virtual bool get_achievement(const char *name, bool *achieved) = 0;
+
+	//whether the achievement is defined in the game's stats schema, to tell a missing achievement apart from a failure to read it
+	virtual bool is_achievement_registered(const char *name) = 0;
+
+	virtual bool set_achievement(const char *name) = 0;
+	virtual bool clear_achievement(const char *name) = 0;
+	virtual bool set_stat(const char *name, const int32 value) = 0;
+	virtual bool indicate_achievement_progress(const char *name, const uint32 current_progress, const uint32 max_progress) = 0;
+	virtual bool store_stats() = 0;
+
+	virtual bool is_ugc_available() const = 0;
+	virtual void create_item(const AppId_t app_id, const EWorkshopFileType file_type, call_result_function<CreateItemResult_t> &&function) = 0;
+	virtual UGCUpdateHandle_t start_item_update(const AppId_t app_id, const PublishedFileId_t published_file_id) = 0;
+	virtual bool set_item_title(const UGCUpdateHandle_t update_handle, const char *title) = 0;
+	virtual bool set_item_content(const UGCUpdateHandle_t update_handle, const char *content_folder) = 0;
+	virtual bool set_item_preview(const UGCUpdateHandle_t update_handle, const char *preview_file) = 0;
+	virtual void submit_item_update(const UGCUpdateHandle_t update_handle, const char *change_note, call_result_function<SubmitItemUpdateResult_t> &&function) = 0;
+	virtual EItemUpdateStatus get_item_update_progress(const UGCUpdateHandle_t update_handle, uint64 *bytes_processed, uint64 *bytes_total) = 0;
+
+	virtual uint32 get_num_subscribed_items() = 0;
+	virtual uint32 get_subscribed_items(PublishedFileId_t *published_file_ids, const uint32 max_entries) = 0;
+	virtual uint32 get_item_state(const PublishedFileId_t published_file_id) = 0;
+	virtual bool get_item_install_info(const PublishedFileId_t published_file_id, uint64 *size_on_disk, char *folder, const uint32 folder_size, uint32 *timestamp) = 0;
+	virtual bool get_item_download_info(const PublishedFileId_t published_file_id, uint64 *bytes_downloaded, uint64 *bytes_total) = 0;
+	virtual bool download_item(const PublishedFileId_t published_file_id, const bool high_priority) = 0;
+
+	//set a function to be called whenever the download of a Workshop item has finished, whether or not it was requested by the launcher
+	void set_item_downloaded_function(std::function<void(const PublishedFileId_t published_file_id, const EResult result)> &&function)
+	{
+		this->item_downloaded_function = std::move(function);
+	}
+
+protected:
+	//wrap the function called for the result of an asynchronous call, so that the call's latency is traced
+	template <typename result_type>
+	static call_result_function<result_type> trace_call_result(const char *name, call_result_function<result_type> &&function)
+	{
+		if (!trace_recorder::is_enabled()) {
+			return std::move(function);
+		}
+
+		const trace_recorder::clock::time_point start_time = trace_recorder::clock::now();
+
+		return [name, start_time, function = std::move(function)](result_type *result, const bool io_failure) {
+			std::string args;
+			trace_recorder::append_arg(args, "io_failure", io_failure ? 1 : 0);
+			trace_recorder::add_async_event(name, "steam", trace_recorder::generate_async_id(), start_time, trace_recorder::clock::now(), std::move(args));
+
+			function(result, io_failure);
+		};
+	}
+
+	void on_call_issued() const
+	{
+		if (this->call_issued_function) {
+			this->call_issued_function();
+		}
+	}
+
+	void on_callback_dispatched()
+	{
+		++this->dispatched_callback_count;
+	}
+
+	void notify_user_stats_received()
+	{
+		this->user_stats_received = true;
+
+		if (this->user_stats_received_function) {
+			this->user_stats_received_function();
+		}
+	}
+
+	void notify_user_stats_stored(const EResult result)
+	{
+		if (this->user_stats_stored_function) {
+			this->user_stats_stored_function(result);
+		}
+	}
+
+	void notify_item_downloaded(const PublishedFileId_t published_file_id, const EResult result)
+	{
+		if (this->item_downloaded_function) {
+			this->item_downloaded_function(published_file_id, result);
+		}
+	}
+
+private:
+	std::function<void()> call_issued_function;
+	std::function<void()> user_stats_received_function;
+	std::function<void(const EResult)> user_stats_stored_function;
+	std::function<void(const PublishedFileId_t, const EResult)> item_downloaded_function;
+	bool user_stats_received = false;
+	uint64_t dispatched_callback_count = 0;
+};
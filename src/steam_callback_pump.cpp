@@ -0,0 +1,82 @@
+#include "steam_callback_pump.h"
+
+#include "steam_backend.h"
+
+#include <algorithm>
+
+steam_callback_pump::steam_callback_pump(steam_backend *backend, QObject *parent) : QObject(parent), backend(backend)
+{
+	this->timer = new QTimer(this);
+	this->timer->setSingleShot(true);
+	connect(this->timer, &QTimer::timeout, this, &steam_callback_pump::pump);
+}
+
+steam_callback_pump::~steam_callback_pump()
+{
+	this->backend->set_call_issued_function(nullptr);
+}
+
+void steam_callback_pump::start()
+{
+	//calls are made from the GUI thread, so the timer can be restarted directly when one is issued
+	this->backend->set_call_issued_function([this]() {
+		this->wake();
+	});
+
+	this->idle_interval_ms = steam_callback_pump::min_idle_interval_ms;
+
+	if (this->backend->get_pending_call_count() > 0) {
+		this->start_timer(steam_callback_pump::busy_interval_ms);
+	} else {
+		this->start_timer(this->idle_interval_ms);
+	}
+}
+
+void steam_callback_pump::stop()
+{
+	this->backend->set_call_issued_function(nullptr);
+	this->timer->stop();
+}
+
+void steam_callback_pump::wake()
+{
+	this->idle_interval_ms = steam_callback_pump::min_idle_interval_ms;
+
+	if (!this->timer->isActive() || this->timer->remainingTime() > steam_callback_pump::busy_interval_ms) {
+		this->start_timer(steam_callback_pump::busy_interval_ms);
+	}
+}
+
+uint64_t steam_callback_pump::get_dispatched_callback_count() const
+{
+	return this->backend->get_dispatched_callback_count();
+}
+
+void steam_callback_pump::pump()
+{
+	++this->wakeup_count;
+
+	this->backend->run_callbacks();
+
+	//the callbacks may have made further calls, which would have restarted the timer already
+	if (this->timer->isActive()) {
+		return;
+	}
+
+	if (this->backend->get_pending_call_count() > 0) {
+		this->idle_interval_ms = steam_callback_pump::min_idle_interval_ms;
+		this->start_timer(steam_callback_pump::busy_interval_ms);
+		return;
+	}
+
+	//callbacks not started by the launcher, such as for the overlay, are still run occasionally while idle
+	this->start_timer(this->idle_interval_ms);
+	this->idle_interval_ms = std::min(this->idle_interval_ms * 2, steam_callback_pump::max_idle_interval_ms);
+}
+
+void steam_callback_pump::start_timer(const int interval_ms)
+{
+	//a precise timer is only needed for the short busy interval, while a coarse one lets the system group the idle wakeups with others
+	this->timer->setTimerType(interval_ms <= steam_callback_pump::busy_interval_ms ? Qt::PreciseTimer : Qt::CoarseTimer);
+	this->timer->start(interval_ms);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+#include <cstdint>
+
+class steam_backend;
+
+//runs the Steam callbacks from the Qt event loop, frequently while call results are pending, and with an increasing interval while idle
+class steam_callback_pump final : public QObject
+{
+	Q_OBJECT
+
+public:
+	static constexpr int busy_interval_ms = 5; //the interval while call results are pending
+	static constexpr int min_idle_interval_ms = 250; //the initial interval after the last pending call result has been received
+	static constexpr int max_idle_interval_ms = 4000;
+
+	explicit steam_callback_pump(steam_backend *backend, QObject *parent = nullptr);
+	~steam_callback_pump();
+
+	void start();
+	void stop();
+
+	//run the callbacks soon, e.g. because an asynchronous call was made
+	void wake();
+
+	uint64_t get_wakeup_count() const
+	{
+		return this->wakeup_count;
+	}
+
+	uint64_t get_dispatched_callback_count() const;
+
+private:
+	void pump();
+	void start_timer(const int interval_ms);
+
+private:
+	steam_backend *backend = nullptr;
+	QTimer *timer = nullptr;
+	int idle_interval_ms = steam_callback_pump::min_idle_interval_ms;
+	uint64_t wakeup_count = 0;
+};
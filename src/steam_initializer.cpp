@@ -0,0 +1,76 @@
+#include "steam_initializer.h"
+
+#include "steam_backend.h"
+#include "trace.h"
+#include "util.h"
+
+#include <QtConcurrent>
+
+#include <memory>
+
+void steam_initializer::call_when_finished(QObject *context, std::function<void()> &&function)
+{
+	steam_initializer *initializer = steam_initializer::get();
+
+	if (initializer == nullptr || initializer->is_finished()) {
+		function();
+		return;
+	}
+
+	//the connection is removed when the function is called, so that it is only called once
+	const std::shared_ptr<QMetaObject::Connection> connection = std::make_shared<QMetaObject::Connection>();
+
+	*connection = connect(initializer, &steam_initializer::finished, context, [connection, function = std::move(function)]() {
+		QObject::disconnect(*connection);
+		function();
+	});
+}
+
+steam_initializer::steam_initializer(steam_backend *backend, QObject *parent) : QObject(parent), backend(backend)
+{
+	steam_initializer::instance = this;
+
+	this->future_watcher = new QFutureWatcher<bool>(this);
+	connect(this->future_watcher, &QFutureWatcher<bool>::finished, this, &steam_initializer::on_init_finished);
+}
+
+steam_initializer::~steam_initializer()
+{
+	//the backend cannot be shut down while it is still being initialized
+	this->future_watcher->waitForFinished();
+
+	if (steam_initializer::instance == this) {
+		steam_initializer::instance = nullptr;
+	}
+}
+
+void steam_initializer::start()
+{
+	steam_backend *steam = this->backend;
+
+	this->future_watcher->setFuture(QtConcurrent::run([steam]() {
+		trace_span span("steam_init", "startup");
+
+		const bool initialized_steam = steam->init();
+
+		if (!initialized_steam) {
+			log_error("Failed to initialize the Steam API.");
+		}
+
+		if (steam->is_user_stats_available()) {
+			steam->request_current_stats();
+		} else {
+			log_error("No Steam user information provided.");
+		}
+
+		return initialized_steam;
+	}));
+}
+
+void steam_initializer::on_init_finished()
+{
+	this->initialized = this->future_watcher->result();
+	this->init_finished = true;
+
+	emit finished();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QFutureWatcher>
+#include <QObject>
+
+#include <functional>
+
+class steam_backend;
+
+//initializes the Steam backend and requests the current stats on a worker thread, so that the launcher window does not have to wait for the Steam client
+//the backend must not be used from other threads until initialization has finished
+class steam_initializer final : public QObject
+{
+	Q_OBJECT
+
+public:
+	static steam_initializer *get()
+	{
+		return steam_initializer::instance;
+	}
+
+	//call the function on the GUI thread once initialization has finished, or immediately if it already has or if initialization does not run asynchronously
+	static void call_when_finished(QObject *context, std::function<void()> &&function);
+
+private:
+	static inline steam_initializer *instance = nullptr;
+
+public:
+	explicit steam_initializer(steam_backend *backend, QObject *parent = nullptr);
+	~steam_initializer();
+
+	void start();
+
+	void wait_for_finished()
+	{
+		this->future_watcher->waitForFinished();
+	}
+
+	bool is_finished() const
+	{
+		return this->init_finished;
+	}
+
+	bool is_initialized() const
+	{
+		return this->initialized;
+	}
+
+signals:
+	void finished();
+
+private:
+	void on_init_finished();
+
+private:
+	steam_backend *backend = nullptr;
+	QFutureWatcher<bool> *future_watcher = nullptr;
+	bool init_finished = false;
+	bool initialized = false;
+};
@@ -0,0 +1,250 @@
+#include "trace.h"
+
+#include "util.h"
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct trace_event final
+{
+	const char *name = nullptr;
+	const char *category = nullptr;
+	char phase = 'X';
+	uint64_t id = 0;
+	int64_t timestamp = 0; //in microseconds since the start of recording
+	int64_t duration = 0;
+	std::string args;
+};
+
+struct thread_buffer final
+{
+	std::mutex mutex; //only contended while the trace is being written
+	uint32_t thread_id = 0;
+	std::string thread_name;
+	std::vector<trace_event> events;
+};
+
+static std::mutex buffers_mutex; //only taken when a thread records its first event, and when the trace is written
+static std::vector<std::shared_ptr<thread_buffer>> buffers;
+static trace_recorder::clock::time_point recording_start_time;
+static std::filesystem::path trace_filepath;
+
+static thread_buffer &get_thread_buffer()
+{
+	//the buffers are kept in the global list as well, so that the events of threads which have finished are still written
+	thread_local std::shared_ptr<thread_buffer> buffer;
+
+	if (buffer == nullptr) {
+		buffer = std::make_shared<thread_buffer>();
+
+		std::lock_guard<std::mutex> lock(buffers_mutex);
+		buffer->thread_id = static_cast<uint32_t>(buffers.size() + 1);
+		buffers.push_back(buffer);
+	}
+
+	return *buffer;
+}
+
+static int64_t to_trace_timestamp(const trace_recorder::clock::time_point time_point)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(time_point - recording_start_time).count();
+}
+
+static void add_event(trace_event &&event)
+{
+	thread_buffer &buffer = get_thread_buffer();
+
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	buffer.events.push_back(std::move(event));
+}
+
+static void append_escaped_string(std::string &str, const std::string_view &value)
+{
+	static constexpr char hex_digits[] = "0123456789abcdef";
+
+	str += '"';
+
+	for (const char c : value) {
+		switch (c) {
+			case '"':
+				str += "\\\"";
+				break;
+			case '\\':
+				str += "\\\\";
+				break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					str += "\\u00";
+					str += hex_digits[(c >> 4) & 0xF];
+					str += hex_digits[c & 0xF];
+				} else {
+					str += c;
+				}
+				break;
+		}
+	}
+
+	str += '"';
+}
+
+static void write_event(std::ofstream &ofstream, const trace_event &event, const uint32_t thread_id)
+{
+	std::string str = "{\"name\":";
+	append_escaped_string(str, event.name);
+	str += ",\"cat\":";
+	append_escaped_string(str, event.category);
+	str += ",\"ph\":\"";
+	str += event.phase;
+	str += "\",\"ts\":" + std::to_string(event.timestamp);
+
+	if (event.phase == 'X') {
+		str += ",\"dur\":" + std::to_string(event.duration);
+	}
+
+	if (event.phase == 'b' || event.phase == 'e') {
+		str += ",\"id\":" + std::to_string(event.id);
+	}
+
+	str += ",\"pid\":1,\"tid\":" + std::to_string(thread_id);
+
+	if (!event.args.empty()) {
+		str += ",\"args\":{" + event.args + "}";
+	}
+
+	str += "}";
+
+	ofstream << str;
+}
+
+void trace_recorder::start(const std::filesystem::path &filepath, const clock::time_point start_time)
+{
+	trace_filepath = filepath;
+	recording_start_time = start_time;
+
+	//the start time and filepath are published to the other threads by this store
+	trace_recorder::enabled.store(true, std::memory_order_release);
+}
+
+void trace_recorder::stop()
+{
+	if (!trace_recorder::is_enabled()) {
+		return;
+	}
+
+	trace_recorder::enabled.store(false, std::memory_order_relaxed);
+
+	std::ofstream ofstream(trace_filepath, std::ios::binary | std::ios::trunc);
+
+	if (!ofstream) {
+		throw std::runtime_error("Failed to open trace file \"" + to_string(trace_filepath) + "\" for writing.");
+	}
+
+	ofstream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool first = true;
+
+	std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+
+	for (const std::shared_ptr<thread_buffer> &buffer : buffers) {
+		std::lock_guard<std::mutex> lock(buffer->mutex);
+
+		if (!buffer->thread_name.empty()) {
+			std::string str = first ? "\n" : ",\n";
+			str += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(buffer->thread_id) + ",\"args\":{\"name\":";
+			append_escaped_string(str, buffer->thread_name);
+			str += "}}";
+			ofstream << str;
+			first = false;
+		}
+
+		for (const trace_event &event : buffer->events) {
+			ofstream << (first ? "\n" : ",\n");
+			write_event(ofstream, event, buffer->thread_id);
+			first = false;
+		}
+
+		buffer->events.clear();
+	}
+
+	ofstream << "\n]}\n";
+
+	if (!ofstream) {
+		throw std::runtime_error("Failed to write trace file \"" + to_string(trace_filepath) + "\".");
+	}
+}
+
+void trace_recorder::set_thread_name(const std::string &name)
+{
+	if (!trace_recorder::is_enabled()) {
+		return;
+	}
+
+	thread_buffer &buffer = get_thread_buffer();
+
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	buffer.thread_name = name;
+}
+
+void trace_recorder::add_complete_event(const char *name, const char *category, const clock::time_point start_time, const clock::time_point end_time, std::string &&args)
+{
+	if (!trace_recorder::is_enabled()) {
+		return;
+	}
+
+	trace_event event;
+	event.name = name;
+	event.category = category;
+	event.phase = 'X';
+	event.timestamp = to_trace_timestamp(start_time);
+	event.duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+	event.args = std::move(args);
+	add_event(std::move(event));
+}
+
+void trace_recorder::add_async_event(const char *name, const char *category, const uint64_t id, const clock::time_point start_time, const clock::time_point end_time, std::string &&args)
+{
+	if (!trace_recorder::is_enabled()) {
+		return;
+	}
+
+	trace_event begin_event;
+	begin_event.name = name;
+	begin_event.category = category;
+	begin_event.phase = 'b';
+	begin_event.id = id;
+	begin_event.timestamp = to_trace_timestamp(start_time);
+	begin_event.args = std::move(args);
+	add_event(std::move(begin_event));
+
+	trace_event end_event;
+	end_event.name = name;
+	end_event.category = category;
+	end_event.phase = 'e';
+	end_event.id = id;
+	end_event.timestamp = to_trace_timestamp(end_time);
+	add_event(std::move(end_event));
+}
+
+void trace_recorder::append_arg(std::string &args, const std::string_view &name, const int64_t value)
+{
+	if (!args.empty()) {
+		args += ',';
+	}
+
+	append_escaped_string(args, name);
+	args += ':';
+	args += std::to_string(value);
+}
+
+void trace_recorder::append_arg(std::string &args, const std::string_view &name, const std::string_view &value)
+{
+	if (!args.empty()) {
+		args += ',';
+	}
+
+	append_escaped_string(args, name);
+	args += ':';
+	append_escaped_string(args, value);
+}
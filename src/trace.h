@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+//records Chrome trace events, which can be viewed in chrome://tracing or Perfetto
+//each thread records into its own buffer, whose lock is only contended while the trace is being written; the global lock is only taken once per thread, when its buffer is registered
+//when recording is disabled, recording an event costs a single acquire load of the enabled flag
+//event names and categories must be string literals, since only their pointers are stored
+class trace_recorder final
+{
+public:
+	using clock = std::chrono::steady_clock;
+
+	static bool is_enabled()
+	{
+		return trace_recorder::enabled.load(std::memory_order_acquire);
+	}
+
+	//start recording; the start time can be earlier than the current time, so that events which have already happened can be added
+	static void start(const std::filesystem::path &filepath, const clock::time_point start_time = clock::now());
+
+	//stop recording, and write the recorded events to the trace file
+	static void stop();
+
+	static void set_thread_name(const std::string &name);
+
+	static void add_complete_event(const char *name, const char *category, const clock::time_point start_time, const clock::time_point end_time, std::string &&args = std::string());
+
+	//add an event which does not need to be nested within the other events of its thread, e.g. for asynchronous calls
+	static void add_async_event(const char *name, const char *category, const uint64_t id, const clock::time_point start_time, const clock::time_point end_time, std::string &&args = std::string());
+
+	static uint64_t generate_async_id()
+	{
+		return ++trace_recorder::last_async_id;
+	}
+
+	//append an argument to the arguments of an event, which are stored as the inside of a JSON object
+	static void append_arg(std::string &args, const std::string_view &name, const int64_t value);
+	static void append_arg(std::string &args, const std::string_view &name, const std::string_view &value);
+
+private:
+	static inline std::atomic<bool> enabled = false;
+	static inline std::atomic<uint64_t> last_async_id = 0;
+};
+
+//records a complete event for its scope
+class trace_span final
+{
+public:
+	explicit trace_span(const char *name, const char *category) : name(name), category(category), active(trace_recorder::is_enabled())
+	{
+		if (this->active) {
+			this->start_time = trace_recorder::clock::now();
+		}
+	}
+
+	trace_span(const trace_span &other) = delete;
+	trace_span &operator =(const trace_span &other) = delete;
+
+	~trace_span()
+	{
+		this->end();
+	}
+
+	//end the span before the end of its scope
+	void end()
+	{
+		if (this->active) {
+			trace_recorder::add_complete_event(this->name, this->category, this->start_time, trace_recorder::clock::now(), std::move(this->args));
+			this->active = false;
+		}
+	}
+
+	template <typename value_type>
+	void add_arg(const std::string_view &arg_name, const value_type &value)
+	{
+		if (this->active) {
+			trace_recorder::append_arg(this->args, arg_name, value);
+		}
+	}
+
+private:
+	const char *name = nullptr;
+	const char *category = nullptr;
+	bool active = false;
+	trace_recorder::clock::time_point start_time;
+	std::string args;
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "logger.h"
+
 #include <QApplication>
 #include <QDateTime>
 #include <QStandardPaths>
@@ -14,12 +16,12 @@ constexpr const uint32_t app_id = 370070;
 
 inline void log(const std::string_view &message)
 {
-	std::cout << "[" << QDateTime::currentDateTime().toString(date_string_format).toStdString() << "] " << message << '\n';
+	logger::write(log_level::info, message);
 }
 
 inline void log_error(const std::string_view &error_message)
 {
-	std::cerr << "[" << QDateTime::currentDateTime().toString(date_string_format).toStdString() << "] " << error_message << std::endl;
+	logger::write(log_level::error, error_message);
 }
 
 inline void report_exception(const std::exception &exception)
@@ -35,61 +37,68 @@ inline void report_exception(const std::exception &exception)
 
 inline void log_qt_message(QtMsgType type, const QMessageLogContext &context, const QString &msg)
 {
-	std::string log_message;
+	std::string_view type_name;
+	log_level level = log_level::info;
 
 	switch (type) {
 		case QtDebugMsg:
-			log_message += "Debug";
+			type_name = "Debug";
+			level = log_level::debug;
 			break;
 		case QtInfoMsg:
-			log_message += "Info";
+			type_name = "Info";
+			level = log_level::info;
 			break;
 		case QtWarningMsg:
-			log_message += "Warning";
+			type_name = "Warning";
+			level = log_level::warning;
 			break;
 		case QtCriticalMsg:
-			log_message += "Critical";
+			type_name = "Critical";
+			level = log_level::error;
 			break;
 		case QtFatalMsg:
-			log_message += "Fatal";
+			type_name = "Fatal";
+			level = log_level::fatal;
 			break;
 	}
 
+	static constexpr std::string_view default_category_name = "default";
+	const std::string_view category = context.category != nullptr && context.category != default_category_name ? context.category : std::string_view();
+	const QByteArray msg_utf8 = msg.toUtf8();
+	const std::string_view file = context.file != nullptr ? context.file : std::string_view();
+	const std::string_view function = context.function != nullptr ? context.function : std::string_view();
+	const std::string line = file.empty() ? std::string() : std::to_string(context.line);
+
+	//build the message with a single allocation, since Qt warnings can come in bursts
+	std::string log_message;
+	log_message.reserve(type_name.size() + category.size() + msg_utf8.size() + file.size() + line.size() + function.size() + 16);
+
+	log_message += type_name;
 	log_message += ": ";
 
-	static const std::string default_category_name = "default";
-	if (context.category != nullptr && context.category != default_category_name) {
-		log_message += context.category;
+	if (!category.empty()) {
+		log_message += category;
 		log_message += ": ";
 	}
 
-	log_message += msg.toStdString();
+	log_message.append(msg_utf8.constData(), static_cast<size_t>(msg_utf8.size()));
 
-	if (context.file != nullptr) {
+	if (!file.empty()) {
 		log_message += " (";
-		log_message += context.file;
+		log_message += file;
 		log_message += ": ";
-		log_message += context.line;
+		log_message += line;
 
-		if (context.function != nullptr) {
+		if (!function.empty()) {
 			log_message += ", ";
-			log_message += context.function;
+			log_message += function;
 		}
 
 		log_message += ")";
 	}
 
-	switch (type) {
-		case QtDebugMsg:
-		case QtInfoMsg:
-			log(log_message);
-			break;
-		case QtWarningMsg:
-		case QtCriticalMsg:
-		case QtFatalMsg:
-			log_error(log_message);
-			break;
-	}
+	logger::write(level, log_message);
 }
 
 inline std::filesystem::path get_user_data_path()
@@ -135,6 +144,27 @@ inline std::filesystem::path get_error_log_filepath()
 	return filepath;
 }
 
+//move a log file to "[name].1", "[name].1" to "[name].2" and so forth, removing the oldest one
+inline void rotate_log_files(const std::filesystem::path &filepath, const int max_rotated_files)
+{
+	const auto get_rotated_filepath = [&filepath](const int index) {
+		std::filesystem::path rotated_filepath = filepath;
+		rotated_filepath += "." + std::to_string(index);
+		return rotated_filepath;
+	};
+
+	//failures are ignored, as the files may not exist, and a failed rotation should not prevent logging
+	std::error_code error_code;
+
+	std::filesystem::remove(get_rotated_filepath(max_rotated_files), error_code);
+
+	for (int i = max_rotated_files - 1; i >= 1; --i) {
+		std::filesystem::rename(get_rotated_filepath(i), get_rotated_filepath(i + 1), error_code);
+	}
+
+	std::filesystem::rename(filepath, get_rotated_filepath(1), error_code);
+}
+
 inline std::string to_string(const std::filesystem::path &path)
 {
 	//convert a path to a UTF-8 encoded string
@@ -142,6 +172,13 @@ inline std::string to_string(const std::filesystem::path &path)
 	return std::string(u8str.begin(), u8str.end());
 }
 
+inline std::string to_generic_string(const std::filesystem::path &path)
+{
+	//convert a path to a UTF-8 encoded string, using forward slashes as directory separators
+	const std::u8string u8str = path.generic_u8string();
+	return std::string(u8str.begin(), u8str.end());
+}
+
 inline QString to_qstring(const std::filesystem::path &path)
 {
 	return QString::fromStdString(to_string(path));
@@ -0,0 +1,447 @@
+#include "workshop_subscription_manager.h"
+
+#include "steam_backend.h"
+#include "steam_initializer.h"
+#include "trace.h"
+#include "util.h"
+
+#include <QTimer>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+std::filesystem::path workshop_subscription_manager::get_cache_filepath()
+{
+	const std::filesystem::path user_data_path = get_user_data_path();
+
+	std::filesystem::path filepath = user_data_path / "workshop_items.txt";
+	filepath.make_preferred();
+	return filepath;
+}
+
+workshop_subscription_manager::workshop_subscription_manager()
+{
+	try {
+		this->load_cache();
+	} catch (const std::exception &exception) {
+		report_exception(exception);
+	}
+
+	this->progress_timer = new QTimer(this);
+	connect(this->progress_timer, &QTimer::timeout, this, &workshop_subscription_manager::update_progress);
+
+	steam_backend::get()->set_item_downloaded_function([this](const PublishedFileId_t published_file_id, const EResult result) {
+		this->on_item_downloaded(published_file_id, result);
+	});
+}
+
+workshop_subscription_manager::~workshop_subscription_manager()
+{
+	if (steam_backend::get() != nullptr) {
+		steam_backend::get()->set_item_downloaded_function(nullptr);
+	}
+}
+
+void workshop_subscription_manager::sync()
+{
+	if (this->syncing) {
+		return;
+	}
+
+	this->syncing = true;
+	this->downloads.clear();
+	this->failed_download_count = 0;
+	this->bytes_downloaded = 0;
+	this->bytes_total = 0;
+	emit syncingChanged();
+	emit progressChanged();
+
+	//the subscribed items can only be checked once Steam has been initialized
+	steam_initializer::call_when_finished(this, [this]() {
+		try {
+			this->check_items();
+		} catch (const std::exception &exception) {
+			report_exception(exception);
+			this->pending_downloads.clear();
+			this->finish_sync();
+		}
+	});
+}
+
+void workshop_subscription_manager::skip_downloads()
+{
+	if (!this->syncing || this->pending_downloads.empty()) {
+		return;
+	}
+
+	log("Not waiting for the download of " + std::to_string(this->pending_downloads.size()) + " subscribed Workshop items.");
+
+	this->pending_downloads.clear();
+	this->finish_sync();
+}
+
+void workshop_subscription_manager::call_when_synced(QObject *context, std::function<void()> &&function)
+{
+	if (!this->syncing) {
+		function();
+		return;
+	}
+
+	//the connection is removed when the function is called, so that it is only called once
+	const std::shared_ptr<QMetaObject::Connection> connection = std::make_shared<QMetaObject::Connection>();
+
+	*connection = connect(this, &workshop_subscription_manager::synced, context, [connection, function = std::move(function)]() {
+		QObject::disconnect(*connection);
+		function();
+	});
+}
+
+double workshop_subscription_manager::get_progress() const
+{
+	if (this->bytes_total > 0) {
+		return static_cast<double>(this->bytes_downloaded) / static_cast<double>(this->bytes_total);
+	}
+
+	if (this->downloads.empty()) {
+		return this->syncing ? 0 : 1;
+	}
+
+	//the sizes of items which are not installed are only known once their download has started
+	return static_cast<double>(this->downloads.size() - this->pending_downloads.size()) / static_cast<double>(this->downloads.size());
+}
+
+void workshop_subscription_manager::load_cache()
+{
+	this->cache.clear();
+
+	const std::filesystem::path filepath = workshop_subscription_manager::get_cache_filepath();
+
+	if (!std::filesystem::exists(filepath)) {
+		return;
+	}
+
+	std::ifstream ifstream(filepath);
+
+	if (!ifstream) {
+		throw std::runtime_error("Failed to open the Workshop item cache for reading.");
+	}
+
+	//each line consists of the item ID, followed by the time at which its installed version was updated and its size
+	std::string line;
+	while (std::getline(ifstream, line)) {
+		std::istringstream line_stream(line);
+		PublishedFileId_t published_file_id = 0;
+		cached_item item;
+
+		if (!(line_stream >> published_file_id >> item.timestamp >> item.size)) {
+			log_error("Invalid line in the Workshop item cache: \"" + line + "\".");
+			continue;
+		}
+
+		this->cache[published_file_id] = item;
+	}
+}
+
+void workshop_subscription_manager::save_cache() const
+{
+	const std::filesystem::path filepath = workshop_subscription_manager::get_cache_filepath();
+
+	std::filesystem::path temp_filepath = filepath;
+	temp_filepath += ".tmp";
+
+	{
+		std::ofstream ofstream(temp_filepath, std::ios::trunc);
+
+		if (!ofstream) {
+			throw std::runtime_error("Failed to open the Workshop item cache for writing.");
+		}
+
+		for (const auto &[published_file_id, item] : this->cache) {
+			ofstream << published_file_id << ' ' << item.timestamp << ' ' << item.size << '\n';
+		}
+
+		if (!ofstream) {
+			throw std::runtime_error("Failed to write the Workshop item cache.");
+		}
+	}
+
+	std::filesystem::rename(temp_filepath, filepath);
+}
+
+void workshop_subscription_manager::check_items()
+{
+	steam_backend *steam = steam_backend::get();
+
+	if (!steam->is_ugc_available()) {
+		log("The subscribed Workshop items cannot be checked, since Steam is not available.");
+		this->finish_sync();
+		return;
+	}
+
+	trace_span span("check_workshop_items", "workshop");
+
+	std::vector<PublishedFileId_t> published_file_ids(steam->get_num_subscribed_items());
+	published_file_ids.resize(steam->get_subscribed_items(published_file_ids.data(), static_cast<uint32>(published_file_ids.size())));
+	this->item_count = static_cast<int>(published_file_ids.size());
+
+	struct stale_item final
+	{
+		PublishedFileId_t published_file_id = 0;
+		bool installed = false;
+		uint64 size = 0;
+	};
+
+	std::vector<stale_item> stale_items;
+	std::map<PublishedFileId_t, cached_item> new_cache;
+	int updated_item_count = 0;
+
+	for (const PublishedFileId_t published_file_id : published_file_ids) {
+		const uint32 state = steam->get_item_state(published_file_id);
+		const auto cache_iterator = this->cache.find(published_file_id);
+		const cached_item *previous_item = cache_iterator != this->cache.end() ? &cache_iterator->second : nullptr;
+
+		uint64 size = 0;
+		uint32 timestamp = 0;
+		char folder[1024];
+		const bool installed = (state & k_EItemStateInstalled) != 0 && steam->get_item_install_info(published_file_id, &size, folder, sizeof(folder), &timestamp);
+
+		//an installed version older than one seen before means that the item's files were rolled back, e.g. by restoring them from a backup
+		const bool outdated = (state & k_EItemStateNeedsUpdate) != 0 || (previous_item != nullptr && timestamp < previous_item->timestamp);
+
+		if (installed && !outdated) {
+			if (previous_item == nullptr || previous_item->timestamp != timestamp) {
+				++updated_item_count;
+			}
+
+			new_cache[published_file_id] = cached_item{ timestamp, size };
+			continue;
+		}
+
+		//the cached version is kept until the item has been downloaded, so that a failed download is retried in the next sync
+		if (previous_item != nullptr) {
+			new_cache[published_file_id] = *previous_item;
+		}
+
+		stale_items.push_back(stale_item{ published_file_id, installed, installed ? size : (previous_item != nullptr ? previous_item->size : 0) });
+	}
+
+	if (new_cache != this->cache) {
+		this->cache = std::move(new_cache);
+		this->cache_changed = true;
+	}
+
+	if (updated_item_count > 0) {
+		log(std::to_string(updated_item_count) + " subscribed Workshop items were installed or updated since the last sync.");
+	}
+
+	//updates of installed items come first, since those are mods the player already uses, and smaller items before larger ones, so that as many mods as possible are ready early
+	std::stable_sort(stale_items.begin(), stale_items.end(), [](const stale_item &lhs, const stale_item &rhs) {
+		if (lhs.installed != rhs.installed) {
+			return lhs.installed;
+		}
+
+		return lhs.size < rhs.size;
+	});
+
+	for (const stale_item &item : stale_items) {
+		this->pending_downloads.push_back(item.published_file_id);
+		this->downloads[item.published_file_id].bytes_total = item.size;
+	}
+
+	//request all downloads at once, so that Steam queues them in order of priority, with the first one taking precedence over anything Steam is downloading in the background
+	for (size_t i = 0; i < this->pending_downloads.size();) {
+		const PublishedFileId_t published_file_id = this->pending_downloads[i];
+
+		if (steam->download_item(published_file_id, i == 0)) {
+			++i;
+			continue;
+		}
+
+		log_error("Failed to start downloading Workshop item " + std::to_string(published_file_id) + ".");
+		++this->failed_download_count;
+		this->downloads.erase(published_file_id);
+		this->pending_downloads.erase(this->pending_downloads.begin() + static_cast<std::ptrdiff_t>(i));
+	}
+
+	if (this->pending_downloads.empty()) {
+		this->finish_sync();
+		return;
+	}
+
+	log("Downloading " + std::to_string(this->pending_downloads.size()) + " of " + std::to_string(this->item_count) + " subscribed Workshop items.");
+
+	this->download_start_time = std::chrono::steady_clock::now();
+	this->last_progress_time = this->download_start_time;
+
+	this->update_progress();
+
+	if (this->syncing) {
+		this->progress_timer->start(workshop_subscription_manager::progress_interval_ms);
+		emit progressChanged();
+	}
+}
+
+void workshop_subscription_manager::on_item_downloaded(const PublishedFileId_t published_file_id, const EResult result)
+{
+	//the item may have been downloaded by the Steam client by itself, or its download may already have been found to be finished by polling, or been skipped
+	if (std::find(this->pending_downloads.begin(), this->pending_downloads.end(), published_file_id) == this->pending_downloads.end()) {
+		return;
+	}
+
+	this->complete_download(published_file_id, result);
+
+	if (this->syncing) {
+		this->update_progress();
+	}
+}
+
+void workshop_subscription_manager::complete_download(const PublishedFileId_t published_file_id, const EResult result)
+{
+	const auto find_iterator = std::find(this->pending_downloads.begin(), this->pending_downloads.end(), published_file_id);
+	if (find_iterator == this->pending_downloads.end()) {
+		return;
+	}
+
+	const bool was_first = find_iterator == this->pending_downloads.begin();
+	this->pending_downloads.erase(find_iterator);
+	this->last_progress_time = std::chrono::steady_clock::now();
+
+	steam_backend *steam = steam_backend::get();
+
+	uint64 size = 0;
+	uint32 timestamp = 0;
+	char folder[1024];
+
+	if (result == k_EResultOK && steam->get_item_install_info(published_file_id, &size, folder, sizeof(folder), &timestamp)) {
+		item_download &download = this->downloads[published_file_id];
+		download.bytes_total = std::max(download.bytes_total, size);
+		download.bytes_downloaded = download.bytes_total;
+
+		this->cache[published_file_id] = cached_item{ timestamp, size };
+		this->cache_changed = true;
+	} else {
+		log_error("Failed to download Workshop item " + std::to_string(published_file_id) + ", result code: " + std::to_string(static_cast<int>(result)) + ".");
+		++this->failed_download_count;
+		this->downloads.erase(published_file_id);
+	}
+
+	if (this->pending_downloads.empty()) {
+		this->finish_sync();
+		return;
+	}
+
+	//give the next item precedence, as Steam would otherwise continue with its own order
+	if (was_first) {
+		steam->download_item(this->pending_downloads.front(), true);
+	}
+
+	emit progressChanged();
+}
+
+void workshop_subscription_manager::update_progress()
+{
+	steam_backend *steam = steam_backend::get();
+
+	std::vector<PublishedFileId_t> finished_downloads;
+
+	for (const PublishedFileId_t published_file_id : this->pending_downloads) {
+		//the completion callback may arrive late or never, e.g. if it was sent before the launcher was listening, so a download is also finished once Steam reports the item as installed and up to date
+		const uint32 state = steam->get_item_state(published_file_id);
+		if ((state & k_EItemStateInstalled) != 0 && (state & (k_EItemStateNeedsUpdate | k_EItemStateDownloading | k_EItemStateDownloadPending)) == 0) {
+			finished_downloads.push_back(published_file_id);
+			continue;
+		}
+
+		uint64 item_bytes_downloaded = 0;
+		uint64 item_bytes_total = 0;
+
+		if (steam->get_item_download_info(published_file_id, &item_bytes_downloaded, &item_bytes_total) && item_bytes_total != 0) {
+			item_download &download = this->downloads[published_file_id];
+			download.bytes_downloaded = item_bytes_downloaded;
+			download.bytes_total = item_bytes_total;
+		}
+	}
+
+	for (const PublishedFileId_t published_file_id : finished_downloads) {
+		this->complete_download(published_file_id, k_EResultOK);
+	}
+
+	if (!this->syncing) {
+		return;
+	}
+
+	quint64 new_bytes_downloaded = 0;
+	quint64 new_bytes_total = 0;
+
+	for (const auto &[published_file_id, download] : this->downloads) {
+		new_bytes_downloaded += download.bytes_downloaded;
+		new_bytes_total += download.bytes_total;
+	}
+
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	if (new_bytes_downloaded != this->bytes_downloaded) {
+		this->last_progress_time = now;
+	}
+
+	if (now - this->last_progress_time >= std::chrono::milliseconds(workshop_subscription_manager::download_stall_timeout_ms)) {
+		this->abandon_downloads("The downloads of subscribed Workshop items have not progressed for " + std::to_string(workshop_subscription_manager::download_stall_timeout_ms / 1000) + " seconds.");
+		return;
+	}
+
+	if (now - this->download_start_time >= std::chrono::milliseconds(workshop_subscription_manager::max_download_wait_ms)) {
+		this->abandon_downloads("The downloads of subscribed Workshop items have taken more than " + std::to_string(workshop_subscription_manager::max_download_wait_ms / 60000) + " minutes.");
+		return;
+	}
+
+	if (new_bytes_downloaded == this->bytes_downloaded && new_bytes_total == this->bytes_total) {
+		return;
+	}
+
+	this->bytes_downloaded = new_bytes_downloaded;
+	this->bytes_total = new_bytes_total;
+	emit progressChanged();
+}
+
+void workshop_subscription_manager::abandon_downloads(const std::string &reason)
+{
+	std::string item_ids;
+	for (const PublishedFileId_t published_file_id : this->pending_downloads) {
+		if (!item_ids.empty()) {
+			item_ids += ", ";
+		}
+
+		item_ids += std::to_string(published_file_id);
+	}
+
+	log_error(reason + " Not waiting any longer for the following items, which Steam continues downloading in the background: " + item_ids + ".");
+
+	this->pending_downloads.clear();
+	this->finish_sync();
+}
+
+void workshop_subscription_manager::finish_sync()
+{
+	this->progress_timer->stop();
+
+	if (this->cache_changed) {
+		try {
+			this->save_cache();
+			this->cache_changed = false;
+		} catch (const std::exception &exception) {
+			report_exception(exception);
+		}
+	}
+
+	if (this->failed_download_count > 0) {
+		log_error(std::to_string(this->failed_download_count) + " subscribed Workshop items could not be downloaded, and may be out of date.");
+	}
+
+	this->syncing = false;
+	emit progressChanged();
+	emit syncingChanged();
+	emit synced();
+}
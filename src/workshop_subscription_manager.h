@@ -0,0 +1,124 @@
+#pragma once
+
+#include "steam/isteamugc.h"
+
+#include <QObject>
+
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+
+class QTimer;
+
+//keeps the Workshop items the player is subscribed to up to date, so that the game is only started once its mods have been downloaded
+//the installed versions are cached, so that an item whose installed version is older than one which was already seen is downloaded again, even if Steam does not flag it as needing an update
+class workshop_subscription_manager final : public QObject
+{
+	Q_OBJECT
+
+	Q_PROPERTY(bool syncing READ is_syncing NOTIFY syncingChanged)
+	Q_PROPERTY(int item_count READ get_item_count NOTIFY progressChanged)
+	Q_PROPERTY(int pending_download_count READ get_pending_download_count NOTIFY progressChanged)
+	Q_PROPERTY(int failed_download_count READ get_failed_download_count NOTIFY progressChanged)
+	Q_PROPERTY(quint64 bytes_downloaded READ get_bytes_downloaded NOTIFY progressChanged)
+	Q_PROPERTY(quint64 bytes_total READ get_bytes_total NOTIFY progressChanged)
+	Q_PROPERTY(double progress READ get_progress NOTIFY progressChanged)
+
+public:
+	static constexpr int progress_interval_ms = 250;
+	static constexpr int download_stall_timeout_ms = 60000; //the time without any download progress after which the remaining downloads are no longer waited for, e.g. because Steam is in offline mode
+	static constexpr int max_download_wait_ms = 15 * 60 * 1000; //the longest time the game waits for the downloads, even if they are progressing
+
+	static std::filesystem::path get_cache_filepath();
+
+	workshop_subscription_manager();
+	~workshop_subscription_manager();
+
+	//check the subscribed items, and download those which are not installed or out of date; does nothing if a sync is already in progress
+	Q_INVOKABLE void sync();
+
+	//stop waiting for the remaining downloads, so that the game can be started without them; Steam continues downloading them in the background
+	Q_INVOKABLE void skip_downloads();
+
+	//call the function once the current sync has finished, or immediately if no sync is in progress
+	void call_when_synced(QObject *context, std::function<void()> &&function);
+
+	bool is_syncing() const
+	{
+		return this->syncing;
+	}
+
+	int get_item_count() const
+	{
+		return this->item_count;
+	}
+
+	int get_pending_download_count() const
+	{
+		return static_cast<int>(this->pending_downloads.size());
+	}
+
+	int get_failed_download_count() const
+	{
+		return this->failed_download_count;
+	}
+
+	quint64 get_bytes_downloaded() const
+	{
+		return this->bytes_downloaded;
+	}
+
+	quint64 get_bytes_total() const
+	{
+		return this->bytes_total;
+	}
+
+	double get_progress() const;
+
+signals:
+	void syncingChanged();
+	void progressChanged();
+	void synced();
+
+private:
+	struct cached_item final
+	{
+		uint32 timestamp = 0; //the time at which the installed version of the item was updated
+		uint64 size = 0;
+
+		bool operator==(const cached_item &other) const = default;
+	};
+
+	struct item_download final
+	{
+		uint64 bytes_downloaded = 0;
+		uint64 bytes_total = 0;
+	};
+
+	void load_cache();
+	void save_cache() const;
+
+	void check_items();
+	void on_item_downloaded(const PublishedFileId_t published_file_id, const EResult result);
+	void complete_download(const PublishedFileId_t published_file_id, const EResult result);
+	void update_progress();
+	void abandon_downloads(const std::string &reason);
+	void finish_sync();
+
+private:
+	std::map<PublishedFileId_t, cached_item> cache; //the installed versions of the items as of the last sync, mapped to the item IDs
+	bool cache_changed = false;
+	bool syncing = false;
+	int item_count = 0;
+	std::deque<PublishedFileId_t> pending_downloads; //the items still being downloaded, in order of priority
+	std::map<PublishedFileId_t, item_download> downloads; //the downloads of the current sync, including the finished ones
+	int failed_download_count = 0;
+	quint64 bytes_downloaded = 0;
+	quint64 bytes_total = 0;
+	QTimer *progress_timer = nullptr;
+	std::chrono::steady_clock::time_point download_start_time;
+	std::chrono::steady_clock::time_point last_progress_time; //the last time at which a download made progress or finished
+};